@@ -0,0 +1,186 @@
+#include <vector>
+#include <memory>
+#include <string>
+#include <thread>
+#include <functional>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include "matrix.hpp"
+
+#ifndef BASISCACHE_H
+#define BASISCACHE_H
+
+//! On-disk cache of generated basis tables
+
+//! Each (order, node family) basis is stored as one binary file holding the
+//! abscissas, quadrature weights, barycentric weights and derivative matrix
+//! behind a header carrying a checksum of each table. Files live in a versioned
+//! subdirectory of the cache directory, so a change of layout never reads old
+//! entries; they are written to a temporary name and renamed into place, so
+//! concurrent writers and interrupted runs never leave a partial entry. Loading
+//! maps the file and verifies every checksum before copying the tables out; an
+//! entry that is missing, truncated or corrupt is simply reported as a miss.
+namespace basisCache{
+
+  /// version of the cache files, bumped whenever the format or the generators change
+  const uint32_t VERSION = 3;
+
+  /// identifies a basis cache file
+  const char MAGIC[8] = {'S','T','B','A','S','I','S','\0'};
+
+  /// fixed-size header at the start of every cache file
+  struct header
+  {
+    char magic[8]; ///< always MAGIC
+    uint32_t version; ///< always VERSION
+    uint32_t family; ///< node family the tables were generated for
+    uint64_t order; ///< number of collocation points
+    uint64_t checksums[4]; ///< checksums of the abscissas, weights, barycentric weights and D
+  };
+
+  /// the tables held by one cache entry, as shared by spectralBasis
+  struct tables
+  {
+    std::shared_ptr<std::vector<double>> abscissas; ///< the collocation points
+    std::shared_ptr<std::vector<double>> weights; ///< the quadrature weights
+    std::shared_ptr<std::vector<double>> baryWeights; ///< the barycentric weights
+    std::shared_ptr<matrix<double>> DMat; ///< the first derivative matrix
+  };
+
+  /// 64-bit FNV-1a hash of a block of doubles
+  /// \param data pointer to the values
+  /// \param count number of values
+  /// \return the checksum
+  inline uint64_t checksum(const double* data, size_t count)
+  {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i=0;i<count*sizeof(double);i++)
+      {
+	hash^=bytes[i];
+	hash*=1099511628211ULL;
+      }
+    return hash;
+  }
+
+  /// The directory holding entries of the current layout version
+  /// \param dir the cache directory
+  /// \return the versioned subdirectory
+  inline std::string versionDirectory(const std::string &dir)
+  {
+    return dir + "/v" + std::to_string(VERSION);
+  }
+
+  /// The file holding one basis
+  /// \param dir the cache directory
+  /// \param order number of collocation points
+  /// \param family node family, as the integer value of nodeFamily
+  /// \return the path of the entry
+  inline std::string entryPath(const std::string &dir, int order, int family)
+  {
+    return versionDirectory(dir) + "/basis_" + std::to_string(family) + "_" + std::to_string(order) + ".bin";
+  }
+
+  /// Loads a basis from the cache
+  /// \param dir the cache directory
+  /// \param order number of collocation points
+  /// \param family node family, as the integer value of nodeFamily
+  /// \param out populated with the tables on success
+  /// \return true if a valid entry was found
+  inline bool load(const std::string &dir, int order, int family, tables &out)
+  {
+    int fd = open(entryPath(dir,order,family).c_str(),O_RDONLY);
+    if(fd < 0)
+      return false;
+    struct stat info;
+    const size_t n = order;
+    const size_t expected = sizeof(header) + (3*n + n*n)*sizeof(double);
+    if(fstat(fd,&info) != 0 || (size_t)info.st_size != expected)
+      {
+	close(fd);
+	return false;
+      }
+    void* mapped = mmap(nullptr,expected,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(mapped == MAP_FAILED)
+      return false;
+
+    const header* head = (const header*)mapped;
+    const double* values = (const double*)((const char*)mapped + sizeof(header));
+    const double* blocks[4] = {values,values + n,values + 2*n,values + 3*n};
+    const size_t counts[4] = {n,n,n,n*n};
+    bool valid = memcmp(head->magic,MAGIC,sizeof(MAGIC)) == 0 && head->version == VERSION
+      && head->family == (uint32_t)family && head->order == (uint64_t)order;
+    for(int b=0;b<4 && valid;b++)
+      valid = checksum(blocks[b],counts[b]) == head->checksums[b];
+    if(valid)
+      {
+	out.abscissas = std::shared_ptr<std::vector<double>>(new std::vector<double>(blocks[0],blocks[0] + n));
+	out.weights = std::shared_ptr<std::vector<double>>(new std::vector<double>(blocks[1],blocks[1] + n));
+	out.baryWeights = std::shared_ptr<std::vector<double>>(new std::vector<double>(blocks[2],blocks[2] + n));
+	out.DMat = std::shared_ptr<matrix<double>>(new matrix<double>(order));
+	for(size_t i=0;i<n;i++)
+	  memcpy((*out.DMat)[i].begin(),blocks[3] + i*n,n*sizeof(double));
+      }
+    munmap(mapped,expected);
+    return valid;
+  }
+
+  /// Stores a basis in the cache, creating the directory if needed. The entry
+  /// is written under a temporary name and renamed into place.
+  /// \param dir the cache directory
+  /// \param order number of collocation points
+  /// \param family node family, as the integer value of nodeFamily
+  /// \param in the tables to store
+  /// \return true if the entry was written
+  inline bool store(const std::string &dir, int order, int family, const tables &in)
+  {
+    boost::system::error_code error;
+    boost::filesystem::create_directories(versionDirectory(dir),error);
+    if(error)
+      return false;
+
+    const size_t n = order;
+    std::vector<double> D(n*n);
+    for(size_t i=0;i<n;i++)
+      memcpy(D.data() + i*n,(*in.DMat)[i].begin(),n*sizeof(double));
+
+    header head;
+    memset(&head,0,sizeof(header));
+    memcpy(head.magic,MAGIC,sizeof(MAGIC));
+    head.version = VERSION;
+    head.family = family;
+    head.order = order;
+    head.checksums[0] = checksum(in.abscissas->data(),n);
+    head.checksums[1] = checksum(in.weights->data(),n);
+    head.checksums[2] = checksum(in.baryWeights->data(),n);
+    head.checksums[3] = checksum(D.data(),n*n);
+
+    std::string path = entryPath(dir,order,family);
+    std::string temporary = path + ".tmp" + std::to_string(getpid()) + "_"
+      + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    FILE* file = fopen(temporary.c_str(),"wb");
+    if(!file)
+      return false;
+    bool written = fwrite(&head,sizeof(header),1,file) == 1
+      && fwrite(in.abscissas->data(),sizeof(double),n,file) == n
+      && fwrite(in.weights->data(),sizeof(double),n,file) == n
+      && fwrite(in.baryWeights->data(),sizeof(double),n,file) == n
+      && fwrite(D.data(),sizeof(double),n*n,file) == n*n;
+    written = (fclose(file) == 0) && written;
+    if(!written || rename(temporary.c_str(),path.c_str()) != 0)
+      {
+	remove(temporary.c_str());
+	return false;
+      }
+    return true;
+  }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include <vector>
+#include <memory>
+#include <functional>
+#include <math.h>
+#include "multiDomainWave.hpp"
+
+#ifndef BENCHWAVES_H
+#define BENCHWAVES_H
+
+/// Builds a wave of the requested type with the given order in each domain,
+/// with data matching the run_wave defaults
+/// \param isDG true for the discontinuous Galerkin wave, false for collocation
+/// \param orders spectral order of each domain
+/// \param x populated with the initial data of the wave
+/// \param chebyshev true for Chebyshev collocation points, false for Legendre
+/// \return the constructed wave
+inline std::shared_ptr<multiDomainWave> makeWave(bool isDG, const std::vector<int> &orders, std::vector<double> &x,
+					      bool chebyshev = false)
+{
+  std::function<double(double)> boundData = [](double x){return cos(2*(x));};
+  std::vector<std::shared_ptr<spectralBasis>> bases;
+  x.clear();
+  for(int d=0;d<(int)orders.size();d++)
+    {
+      bases.push_back(spectralBasis::get(orders[d],isDG ? gaussNodes
+					 : (chebyshev ? chebyshevLobattoNodes : gaussLobattoNodes)));
+      for(int i=0;i<orders[d];i++)
+	x.push_back(boundData(-(bases[d]->abscissas->at(i) + 2.0*d )));
+      for(int i=0;i<orders[d];i++)
+	x.push_back(-boundData(-(bases[d]->abscissas->at(i) + 2.0*d )));
+    }
+  if(isDG)
+    return std::shared_ptr<multiDomainWave>(new DGTransmittingMultiWave(bases,boundData,false,false));
+  return std::shared_ptr<multiDomainWave>(new collTransmittingMultiWave(bases,boundData,false,false));
+}
+
+/// Builds a wave of the requested type with every domain at the same order
+/// \param isDG true for the discontinuous Galerkin wave, false for collocation
+/// \param doms number of domains
+/// \param order spectral order of each domain
+/// \param x populated with the initial data of the wave
+/// \param chebyshev true for Chebyshev collocation points, false for Legendre
+/// \return the constructed wave
+inline std::shared_ptr<multiDomainWave> makeWave(bool isDG, int doms, int order, std::vector<double> &x,
+					      bool chebyshev = false)
+{
+  return makeWave(isDG,std::vector<int>(doms,order),x,chebyshev);
+}
+
+#endif
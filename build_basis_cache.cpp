@@ -0,0 +1,58 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <stdio.h>
+#include <boost/program_options.hpp>
+#include "spectralBasis.hpp"
+
+/// Pre-populates the on-disk basis cache for a range of orders, generating
+/// the missing entries on several threads. Entries already in the cache and
+/// passing their checksums are left untouched.
+int main(int argv, char * args[])
+{
+  boost::program_options::options_description desc("Options");
+  desc.add_options()
+    ("help","show this help message")
+    ("basis-cache",boost::program_options::value<std::string>(),"directory of the basis cache to populate")
+    ("min-ord",boost::program_options::value<int>(),"lowest spectral order to generate (default 2)")
+    ("max-ord",boost::program_options::value<int>(),"highest spectral order to generate")
+    ("type",boost::program_options::value<std::string>(),"node family to generate (coll,dg,both)")
+    ("threads",boost::program_options::value<int>(),"number of generating threads (default all cores)");
+
+  boost::program_options::variables_map vars;
+  boost::program_options::store(boost::program_options::parse_command_line(argv,args,desc),vars);
+
+  if(vars.count("help") || !vars.count("basis-cache") || !vars.count("max-ord")) {
+    desc.print(std::cout);
+    return 1;
+  }
+
+  int minOrder = vars.count("min-ord") ? vars["min-ord"].as<int>() : 2;
+  int maxOrder = vars["max-ord"].as<int>();
+  int threads = vars.count("threads") ? vars["threads"].as<int>() : std::thread::hardware_concurrency();
+  std::string type = vars.count("type") ? vars["type"].as<std::string>() : "both";
+  spectralBasis::setCacheDirectory(vars["basis-cache"].as<std::string>());
+
+  std::vector<std::pair<int,nodeFamily>> work;
+  // largest orders first, so the most expensive entries do not trail at the end
+  for(int order=maxOrder;order>=std::max(minOrder,2);order--)
+    {
+      if(type != "coll")
+	work.push_back(std::make_pair(order,gaussNodes));
+      if(type != "dg")
+	work.push_back(std::make_pair(order,gaussLobattoNodes));
+    }
+
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> pool;
+  for(int t=0;t<std::max(threads,1);t++)
+    pool.push_back(std::thread([&](){
+	  for(size_t i=next++;i<work.size();i=next++)
+	    spectralBasis::load(work[i].first,work[i].second);
+	}));
+  for(auto &thread : pool)
+    thread.join();
+  printf("basis cache populated for orders %d to %d\n",std::max(minOrder,2),maxOrder);
+  return 0;
+}
@@ -0,0 +1,170 @@
+#include <vector>
+#include <memory>
+#include <complex>
+#include <math.h>
+#include <boost/math/special_functions/gamma.hpp>
+#include "fft.hpp"
+
+#ifndef CHEBYSHEVTOOLS_H
+#define CHEBYSHEVTOOLS_H
+
+//! Tools for Chebyshev-Gauss-Lobatto collocation
+
+//! The Chebyshev-Gauss-Lobatto points \f$x_i = -\cos(\pi i/N)\f$, N = n-1, have
+//! closed-form quadrature and barycentric weights, and values at them are
+//! related to Chebyshev coefficients by a type-I discrete cosine transform,
+//! so derivatives can be taken in O(n log n) with FFTs rather than with a
+//! dense derivative matrix.
+namespace chebyshevTools{
+
+  /// Generates the Chebyshev-Gauss-Lobatto points in increasing order, in the
+  /// sine form, which is exactly antisymmetric about 0
+  /// \param order number of collocation points, at least 2
+  /// \return a shared_ptr to the abscissas
+  static std::shared_ptr<std::vector<double>> generateAbscissas(int order)
+  {
+    const int N = order - 1;
+    std::shared_ptr<std::vector<double>> abscissas(new std::vector<double>(order));
+    for(int i=0;i<order;i++)
+      abscissas->at(i) = sin(M_PI*(2*i - N)/(2.0*N));
+    return abscissas;
+  }
+
+  /// Generates the Clenshaw-Curtis quadrature weights of the points,
+  /// \f$w_i = \frac{c_i}{N}\left(1 - \sum_{k=1}^{\lfloor N/2 \rfloor}
+  /// \frac{b_k}{4k^2-1}\cos(2\pi k i/N)\right)\f$ with \f$c_i\f$ 1 at the
+  /// endpoints and 2 otherwise, \f$b_k\f$ 1 for k = N/2 and 2 otherwise
+  /// \param order number of collocation points, at least 2
+  /// \return a shared_ptr to the weights
+  static std::shared_ptr<std::vector<double>> generateWeights(int order)
+  {
+    const int N = order - 1;
+    std::shared_ptr<std::vector<double>> weights(new std::vector<double>(order));
+    for(int i=0;i<order;i++)
+      {
+	double sum = 1.0;
+	for(int k=1;2*k<=N;k++)
+	  sum-=((2*k == N) ? 1.0 : 2.0)/(4.0*k*k - 1)*cos(2*M_PI*((long)k*i % N)/N);
+	weights->at(i) = ((i == 0 || i == N) ? 1.0 : 2.0)*sum/N;
+      }
+    return weights;
+  }
+
+  /// Generates the barycentric weights of the points in closed form,
+  /// \f$(-1)^i\f$, halved at the endpoints. These differ from the product
+  /// formula by a common factor, which cancels in every use.
+  /// \param order number of collocation points, at least 2
+  /// \return a shared_ptr to the barycentric weights
+  static std::shared_ptr<std::vector<double>> generateBaryWeights(int order)
+  {
+    std::shared_ptr<std::vector<double>> bary(new std::vector<double>(order));
+    for(int i=0;i<order;i++)
+      bary->at(i) = ((i%2) ? -1.0 : 1.0)*((i == 0 || i == order - 1) ? 0.5 : 1.0);
+    return bary;
+  }
+
+  /// FFT-based transforms on the Chebyshev-Gauss-Lobatto points
+
+  /// Values at the points and Chebyshev coefficients are related by a type-I
+  /// discrete cosine transform, done as an FFT of the even extension of length
+  /// 2N. As the data is real, two fields are packed into the real and
+  /// imaginary parts of a single complex transform.
+  class transform
+  {
+  public:
+    int n; ///< number of collocation points
+
+    /// precomputes the FFT plan and the Legendre connection coefficients
+    /// \param order number of collocation points, at least 2
+    transform(int order)
+      : n(order), plan(2*(order - 1)), lambda(2*order)
+    {
+      for(int m=0;m<2*n;m++)
+	lambda[m] = boost::math::tgamma_delta_ratio(m/2.0 + 0.5,0.5);
+    }
+
+    /// Differentiates two fields at once in O(n log n): transforms both to
+    /// Chebyshev coefficients, applies the derivative recurrence
+    /// \f$b_{k-1} = b_{k+1} + 2k a_k\f$, and transforms back.
+    /// \param u pointer to the values of the first field
+    /// \param v pointer to the values of the second field
+    /// \param du pointer to the derivative of the first field, populated as return parameter
+    /// \param dv pointer to the derivative of the second field, populated as return parameter
+    void derivative(const double* u, const double* v, double* du, double* dv) const
+    {
+      const int N = n - 1;
+      // grown once per thread, so that repeated differentiation does not allocate
+      thread_local std::vector<std::complex<double>> work;
+      if((int)work.size() < 2*N)
+	work.resize(2*N);
+      coefficients(u,v,work.data());
+      // a_k lies in work[k]; sweep down to the derivative coefficients
+      std::complex<double> next = 0.0, nextNext = 0.0;
+      for(int k=N;k>=1;k--)
+	{
+	  const std::complex<double> b = nextNext + 2.0*k*work[k];
+	  nextNext = next;
+	  next = b;
+	  work[k] = nextNext;
+	}
+      // the sweep leaves twice b_0, which is what the even extension below needs
+      work[0] = next;
+      // back to values: sum_k b_k cos(pi k m/N)
+      for(int k=1;k<N;k++)
+	work[2*N - k] = work[k];
+      plan.forward(work.data());
+      for(int i=0;i<n;i++)
+	{
+	  du[i] = 0.5*work[N - i].real();
+	  dv[i] = 0.5*work[N - i].imag();
+	}
+    }
+
+    /// Transforms values at the points to the Legendre coefficients of their
+    /// interpolant, exactly: Chebyshev coefficients by the cosine transform,
+    /// then a back substitution with the upper triangular Legendre-to-Chebyshev
+    /// connection matrix, \f$M_{jk} = \frac{2}{\pi} \Lambda(\frac{k-j}{2})
+    /// \Lambda(\frac{k+j}{2})\f$ for even \f$k - j \ge 0\f$ (halved in row 0).
+    /// \param nodal pointer to the n collocation values
+    /// \param modal pointer to the n Legendre coefficients, populated as return parameter
+    void toLegendre(const double* nodal, double* modal) const
+    {
+      std::vector<std::complex<double>> work(2*(n - 1));
+      coefficients(nodal,nodal,work.data());
+      for(int k=n-1;k>=0;k--)
+	{
+	  double sum = work[k].real();
+	  for(int l=k+2;l<n;l+=2)
+	    sum-=connection(k,l)*modal[l];
+	  modal[k] = sum/connection(k,k);
+	}
+    }
+
+  private:
+    fft::plan plan; ///< the plan of the even extension, length 2N
+    std::vector<double> lambda; ///< \f$\Lambda(m/2) = \Gamma(\frac{m+1}{2})/\Gamma(\frac{m}{2}+1)\f$
+
+    /// the Legendre-to-Chebyshev connection coefficient \f$M_{jk}\f$, for even k - j
+    double connection(int j, int k) const
+    {
+      return ((j == 0) ? 1.0 : 2.0)/M_PI*lambda[k - j]*lambda[k + j];
+    }
+
+    /// Chebyshev coefficients of two fields, the first in the real and the
+    /// second in the imaginary parts of work[0..N]
+    void coefficients(const double* u, const double* v, std::complex<double>* work) const
+    {
+      const int N = n - 1;
+      // point m of the transform is x = cos(pi m/N), node N - m in increasing order
+      for(int m=0;m<=N;m++)
+	work[m] = std::complex<double>(u[N - m],v[N - m]);
+      for(int m=1;m<N;m++)
+	work[2*N - m] = work[m];
+      plan.forward(work);
+      for(int k=0;k<=N;k++)
+	work[k]*=((k == 0 || k == N) ? 0.5 : 1.0)/N;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <boost/numeric/odeint.hpp>
+#include "benchWaves.hpp"
+#include "waveAlgebra.hpp"
+#include "lowStorageRK.hpp"
+
+/// number of allocations made through the global operator new
+std::atomic<long> allocationCount(0);
+
+/// counting replacement of the global operator new
+void* operator new(size_t size)
+{
+  allocationCount++;
+  void* p = malloc(size ? size : 1);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+/// counting replacement of the aligned global operator new
+void* operator new(size_t size, std::align_val_t align)
+{
+  allocationCount++;
+  void* p = aligned_alloc((size_t)align,(((size ? size : 1) + (size_t)align - 1)/(size_t)align)*(size_t)align);
+  if(!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+/// Releases memory from either counting operator new; malloc and
+/// aligned_alloc both pair with free. Kept out of line so that, once a
+/// replacement operator delete is inlined, the compiler does not see free()
+/// applied to the result of operator new and flag it (-Wmismatched-new-delete)
+/// \param p the memory to release, or null
+__attribute__((noinline)) void releaseAllocation(void* p) noexcept
+{
+  free(p);
+}
+
+/// replacements of the global operator delete, in every form the library
+/// may call for memory from the operator new replacements above
+void operator delete(void* p) noexcept{ releaseAllocation(p);}
+void operator delete(void* p, size_t) noexcept{ releaseAllocation(p);}
+void operator delete(void* p, std::align_val_t) noexcept{ releaseAllocation(p);}
+void operator delete(void* p, size_t, std::align_val_t) noexcept{ releaseAllocation(p);}
+
+/// Counts the heap allocations made while stepping a wave, leaving out the
+/// first step, in which the stepper sizes its own state and thread-local
+/// scratch (matrix packing, FFT work) may be sized
+/// \param stepper the stepper
+/// \param wave the wave integrated
+/// \param x the state, advanced in place
+/// \param steps number of steps, including the first
+/// \return the number of allocations seen after the first step
+template <class Stepper>
+long countSteps(Stepper &stepper, multiDomainWave &wave, std::vector<double> &x, int steps)
+{
+  const double dt = 0.001;
+  stepper.do_step(boost::ref(wave),x,0.0,dt);
+  const long before = allocationCount;
+  for(int s=1;s<steps;s++)
+    stepper.do_step(boost::ref(wave),x,s*dt,dt);
+  return allocationCount - before;
+}
+
+/// Counts the heap allocations made while integrating each wave type with
+/// each derivative engine, serial and on the thread pool, with odeint's RK4
+/// on its range_algebra and on the waveAlgebra, and with the low-storage RK
+/// stepper, whose stages are folded into the right-hand side
+/// \return the number of allocations seen
+long countAllocations()
+{
+  typedef boost::numeric::odeint::runge_kutta4<std::vector<double>,double,std::vector<double>,double,waveAlgebra,
+					       boost::numeric::odeint::default_operations> algebraRK4;
+  const int steps = 100;
+  const std::vector<std::pair<derivativeEngine,const char*>> engines =
+    {{automaticDerivatives,"auto"},{denseDerivatives,"dense"},{batchedDerivatives,"batched"},
+     {evenOddDerivatives,"evenodd"},{fixedDerivatives,"fixed"},{fftDerivatives,"fft"}};
+  const char* steppers[] = {"rk4","rk4 wave","lsrk"};
+  struct config{ bool isDG; bool chebyshev; int doms; int order; int threads; const char* name;};
+  const std::vector<config> configs =
+    {{true,false,16,20,1,"DG"},{false,false,16,20,1,"collocation"},{false,true,1,129,1,"collocation cheb"},
+     {true,false,16,20,4,"DG 4 threads"},{false,false,16,20,4,"collocation 4 thr"}};
+  printf("%18s %6s %6s %8s %9s %6s %12s\n","wave","doms","n","engine","stepper","steps","allocations");
+  long total = 0;
+  for(const config &c : configs)
+    for(auto &e : engines)
+      for(int s=0;s<3;s++)
+	{
+	  std::vector<double> x;
+	  std::shared_ptr<multiDomainWave> wave = makeWave(c.isDG,c.doms,c.order,x,c.chebyshev);
+	  wave->engine = e.first;
+	  wave->setThreads(c.threads);
+	  long count = 0;
+	  if(s == 0)
+	    {
+	      boost::numeric::odeint::runge_kutta4<std::vector<double>> rk;
+	      count = countSteps(rk,*wave,x,steps);
+	    }
+	  else if(s == 1)
+	    {
+	      algebraRK4 rk((waveAlgebra(wave.get())));
+	      count = countSteps(rk,*wave,x,steps);
+	    }
+	  else
+	    {
+	      lowStorageRK rk;
+	      count = countSteps(rk,*wave,x,steps);
+	    }
+	  printf("%18s %6d %6d %8s %9s %6d %12ld\n",c.name,c.doms,c.order,e.second,steppers[s],steps,count);
+	  total+=count;
+	}
+  printf(total ? "FAILED: integration allocated\n" : "no allocations while integrating\n");
+  return total;
+}
+
+/// Checks that integrating the waves makes no heap allocations, for every
+/// wave type, derivative engine and stepper, serial and on the thread pool. Kept out
+/// of run_bench so that the counting operator new does not slow down the
+/// allocations of the benchmarks. Exits non-zero if any allocation is seen.
+int main(int argv, char * args[])
+{
+  return countAllocations() != 0;
+}
@@ -0,0 +1,198 @@
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <math.h>
+#include <boost/math/special_functions/gamma.hpp>
+#include "fft.hpp"
+
+#ifndef FASTLEGENDRE_H
+#define FASTLEGENDRE_H
+
+/// O(n log n) nodal-to-modal Legendre transform
+
+/// Computes the same coefficients as the dense quadrature transform,
+/// \f$c_i = \frac{2i+1}{2} \sum_j w_j f_j P_i(x_j)\f$, in two fast stages.
+///
+/// First the Chebyshev sums \f$h_k = \sum_j w_j f_j T_k(x_j) = \sum_j w_j f_j
+/// \cos(k\theta_j)\f$ are formed by a Taylor-expanded non-uniform FFT: each
+/// \f$\theta_j\f$ is split into its nearest point \f$2\pi l/M\f$ of an
+/// oversampled uniform grid plus a small offset \f$\delta_j\f$, and
+/// \f$e^{ik\delta_j}\f$ is expanded in a short Taylor series, each term of
+/// which is one FFT of length M.
+///
+/// Then, since \f$P_i = \sum_k M_{ki} T_k\f$, the Legendre sums are \f$M^T h\f$.
+/// The Legendre-to-Chebyshev connection matrix is
+/// \f$M_{jk} = \frac{2}{\pi} \Lambda(\frac{k-j}{2}) \Lambda(\frac{k+j}{2})\f$ for even
+/// \f$k - j \ge 0\f$ (halved in row 0), with \f$\Lambda(z) = \Gamma(z + \frac12)/\Gamma(z+1)\f$:
+/// the Hadamard product of an upper triangular Toeplitz matrix and a positive
+/// semi-definite Hankel matrix. A pivoted Cholesky factorization makes the
+/// Hankel part \f$\sum_r \ell_r \ell_r^T\f$ with a rank growing only like
+/// \f$\log n \log(1/\epsilon)\f$, and each term \f$D_{\ell_r} T^T D_{\ell_r}\f$ is applied
+/// as an FFT convolution [Townsend, Webb, Olver; Fast polynomial transforms
+/// based on Toeplitz and Hankel matrices].
+class fastLegendreTransform
+{
+public:
+  int n; ///< number of collocation points
+  int gridLength; ///< length M of the oversampled non-uniform FFT grid
+  int taylorTerms; ///< number of Taylor terms of the non-uniform FFT
+  int convolutionLength; ///< FFT length of the Toeplitz convolutions
+
+  /// Precomputes the grid assignment, Taylor offsets, Hankel factors and
+  /// Toeplitz spectrum for a set of nodes
+  /// \param order number of collocation points
+  /// \param abscissas the collocation points, in [-1,1]
+  /// \param weights the quadrature weights of the points
+  /// \param tol relative accuracy of the Taylor series and Hankel factorization
+  fastLegendreTransform(int order, const std::vector<double> &abscissas, const std::vector<double> &weights,
+			double tol = 1e-16)
+    : n(order), gridLength(fft::paddedLength(4*order)), convolutionLength(fft::paddedLength(2*order)),
+      gridPlan(gridLength), convolutionPlan(convolutionLength), quadWeights(weights),
+      gridIndex(order), offset(order)
+  {
+    // nearest grid point and the offset from it, scaled by n so that the
+    // Taylor terms (k delta)^p = (k/n)^p (n delta)^p stay in range
+    for(int j=0;j<n;j++)
+      {
+	double theta = acos(std::max(-1.0,std::min(1.0,abscissas[j])));
+	int l = (int)lround(theta*gridLength/(2*M_PI));
+	gridIndex[j] = l % gridLength;
+	offset[j] = n*(theta - 2*M_PI*l/gridLength);
+      }
+    // |k delta| <= n pi/M, so the series tail is bounded by (n pi/M)^p/p!
+    const double bound = n*M_PI/gridLength;
+    double term = 1;
+    taylorTerms = 1;
+    while(term > tol*1e-1 && taylorTerms < 64)
+      {
+	term*=bound/taylorTerms;
+	taylorTerms++;
+      }
+    taylorTerms+=taylorTerms%2;
+
+    // Lambda(m/2) for every index of either matrix
+    std::vector<double> lambda(2*n);
+    for(int m=0;m<2*n;m++)
+      lambda[m] = boost::math::tgamma_delta_ratio(m/2.0 + 0.5,0.5);
+
+    // the Toeplitz part, lower triangular once transposed, as a causal
+    // convolution kernel
+    toeplitzSpectrum.assign(convolutionLength,0.0);
+    for(int m=0;m<n;m+=2)
+      toeplitzSpectrum[m] = lambda[m];
+    convolutionPlan.forward(toeplitzSpectrum.data());
+
+    // pivoted Cholesky of the Hankel part H_jk = Lambda((j+k)/2)
+    std::vector<double> residual(n);
+    for(int j=0;j<n;j++)
+      residual[j] = lambda[2*j];
+    const double scale = residual[0];
+    while(true)
+      {
+	int pivot = std::max_element(residual.begin(),residual.end()) - residual.begin();
+	if(residual[pivot] <= tol*scale || (int)factors.size() >= n)
+	  break;
+	std::vector<double> column(n);
+	for(int j=0;j<n;j++)
+	  column[j] = lambda[j + pivot];
+	for(auto &f : factors)
+	  for(int j=0;j<n;j++)
+	    column[j]-=f[j]*f[pivot];
+	const double root = sqrt(residual[pivot]);
+	for(int j=0;j<n;j++)
+	  {
+	    column[j]/=root;
+	    residual[j] = std::max(0.0,residual[j] - column[j]*column[j]);
+	  }
+	residual[pivot] = 0;
+	factors.push_back(column);
+      }
+    if(factors.size()%2)
+      factors.push_back(std::vector<double>(n,0.0));
+  }
+
+  /// number of terms in the low-rank Hankel factorization
+  int rank() const
+  {
+    return factors.size();
+  }
+
+  /// Transforms collocation values to Legendre coefficients. Safe to call
+  /// concurrently; all scratch space is local.
+  /// \param nodal pointer to the n collocation values
+  /// \param modal pointer to the n coefficients, populated as return parameter
+  void forward(const double* nodal, double* modal) const
+  {
+    // Chebyshev sums by the Taylor non-uniform FFT, two real terms per complex transform
+    std::vector<double> h(n,0.0);
+    std::vector<std::complex<double>> grid(gridLength);
+    std::vector<double> power(n),kPower(n,1.0);
+    for(int j=0;j<n;j++)
+      power[j] = quadWeights[j]*nodal[j];
+    double factorial = 1;
+    for(int p=0;p<taylorTerms;p+=2)
+      {
+	std::fill(grid.begin(),grid.end(),0.0);
+	for(int j=0;j<n;j++)
+	  {
+	    grid[gridIndex[j]]+=std::complex<double>(power[j],power[j]*offset[j]);
+	    power[j]*=offset[j]*offset[j];
+	  }
+	gridPlan.inverse(grid.data());
+	const double f0 = 1.0/factorial;
+	const double f1 = f0/(p + 1);
+	factorial*=(p + 1)*(p + 2);
+	for(int k=0;k<n;k++)
+	  {
+	    // separate the transforms of the two real sequences packed together
+	    const std::complex<double> z = grid[k];
+	    const std::complex<double> zc = std::conj(grid[(gridLength - k) % gridLength]);
+	    const std::complex<double> even = 0.5*(z + zc);
+	    const std::complex<double> odd = std::complex<double>(0,-0.5)*(z - zc);
+	    // Re[(i k/n)^p Y_p] cycles through Re, -Im, -Re, Im
+	    const double s = kPower[k];
+	    const double t = s*k/n;
+	    kPower[k] = t*k/n;
+	    h[k]+=(p%4 == 0) ? f0*s*even.real() : -f0*s*even.real();
+	    h[k]+=((p + 1)%4 == 1) ? -f1*t*odd.imag() : f1*t*odd.imag();
+	  }
+      }
+
+    // Legendre sums M^T h = sum_r D_r T^T D_r (d h), two ranks per complex convolution
+    std::vector<double> v(n);
+    for(int k=0;k<n;k++)
+      v[k] = ((k == 0) ? 1.0 : 2.0)/M_PI*h[k];
+    std::vector<double> sums(n,0.0);
+    std::vector<std::complex<double>> conv(convolutionLength);
+    for(size_t r=0;r<factors.size();r+=2)
+      {
+	const std::vector<double> &a = factors[r];
+	const std::vector<double> &b = factors[r + 1];
+	for(int k=0;k<n;k++)
+	  conv[k] = std::complex<double>(a[k]*v[k],b[k]*v[k]);
+	std::fill(conv.begin() + n,conv.end(),0.0);
+	convolutionPlan.forward(conv.data());
+	for(int k=0;k<convolutionLength;k++)
+	  {
+	    const std::complex<double> x = conv[k], y = toeplitzSpectrum[k];
+	    conv[k] = std::complex<double>(x.real()*y.real() - x.imag()*y.imag(),x.real()*y.imag() + x.imag()*y.real());
+	  }
+	convolutionPlan.inverse(conv.data());
+	for(int i=0;i<n;i++)
+	  sums[i]+=(a[i]*conv[i].real() + b[i]*conv[i].imag())/convolutionLength;
+      }
+    for(int i=0;i<n;i++)
+      modal[i] = sums[i]*(2*i + 1)/2;
+  }
+
+private:
+  fft::plan gridPlan; ///< transforms of the non-uniform FFT grid
+  fft::plan convolutionPlan; ///< transforms of the Toeplitz convolutions
+  std::vector<double> quadWeights; ///< the quadrature weights
+  std::vector<int> gridIndex; ///< the nearest grid point of each node
+  std::vector<double> offset; ///< n times the offset of each node from its grid point
+  std::vector<std::complex<double>> toeplitzSpectrum; ///< FFT of the Toeplitz convolution kernel
+  std::vector<std::vector<double>> factors; ///< the Hankel factors, an even number of them
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include <vector>
+#include <complex>
+#include <memory>
+#include <math.h>
+
+#ifndef FFT_H
+#define FFT_H
+
+//! A small self-contained fast Fourier transform
+
+//! Iterative radix-2 transforms of complex data whose length is a power of
+//! two. Other lengths, which transforms tied to a node count cannot pad away,
+//! are reduced to a power-of-two convolution by Bluestein's chirp-z
+//! algorithm. A plan holds the bit-reversal permutation, twiddle factors and
+//! chirps of one length, so repeated transforms do no trigonometry.
+namespace fft{
+
+  /// smallest power of two at least n
+  /// \param n the required length
+  /// \return the padded length
+  inline int paddedLength(int n)
+  {
+    int len = 1;
+    while(len < n)
+      len*=2;
+    return len;
+  }
+
+  /// precomputed tables for transforms of one power-of-two length
+  class plan
+  {
+  public:
+    int size; ///< transform length, a power of two
+
+    /// builds the tables for a length
+    /// \param length the transform length
+    plan(int length)
+      : size(length)
+    {
+      if(paddedLength(size) != size)
+	{
+	  // X_k = conj(w_k) sum_j (x_j conj(w_j)) w_(k-j) with chirp w_k = e^(i pi k^2/N),
+	  // a convolution which is done at a padded power-of-two length
+	  chirp.resize(size);
+	  for(long k=0;k<size;k++)
+	    chirp[k] = std::polar(1.0,M_PI*((k*k) % (2*(long)size))/size);
+	  convolution = std::make_shared<plan>(paddedLength(2*size - 1));
+	  chirpSpectrum.assign(convolution->size,0.0);
+	  chirpSpectrum[0] = chirp[0];
+	  for(int k=1;k<size;k++)
+	    chirpSpectrum[k] = chirpSpectrum[convolution->size - k] = chirp[k];
+	  convolution->forward(chirpSpectrum.data());
+	  return;
+	}
+      reversed.resize(size);
+      twiddles.resize(size/2);
+      int bits = 0;
+      while((1 << bits) < size)
+	bits++;
+      for(int i=0;i<size;i++)
+	{
+	  int r = 0;
+	  for(int b=0;b<bits;b++)
+	    if(i & (1 << b))
+	      r|=1 << (bits - 1 - b);
+	  reversed[i] = r;
+	}
+      for(int k=0;k<size/2;k++)
+	twiddles[k] = std::polar(1.0,-2.0*M_PI*k/size);
+    }
+
+    /// In-place forward transform, \f$X_k = \sum_j x_j e^{-2\pi i jk/N}\f$
+    /// \param data pointer to size values
+    void forward(std::complex<double>* data) const
+    {
+      transform(data,false);
+    }
+
+    /// In-place unnormalized inverse transform, \f$x_j = \sum_k X_k e^{2\pi i jk/N}\f$
+    /// \param data pointer to size values
+    void inverse(std::complex<double>* data) const
+    {
+      transform(data,true);
+    }
+
+  private:
+    std::vector<int> reversed; ///< the bit-reversal permutation
+    std::vector<std::complex<double>> twiddles; ///< \f$e^{-2\pi i k/N}\f$ for k < N/2
+    std::vector<std::complex<double>> chirp; ///< \f$e^{i\pi k^2/N}\f$, for lengths that are not powers of two
+    std::vector<std::complex<double>> chirpSpectrum; ///< transform of the chirp, wrapped to the convolution length
+    std::shared_ptr<plan> convolution; ///< the power-of-two plan of Bluestein's convolution
+
+    /// the butterflies shared by both directions
+    void transform(std::complex<double>* data, bool inverse) const
+    {
+      if(convolution)
+	{
+	  bluestein(data,inverse);
+	  return;
+	}
+      for(int i=0;i<size;i++)
+	if(i < reversed[i])
+	  std::swap(data[i],data[reversed[i]]);
+      for(int len=2;len<=size;len*=2)
+	{
+	  const int half = len/2;
+	  const int step = size/len;
+	  for(int start=0;start<size;start+=len)
+	    for(int k=0;k<half;k++)
+	      {
+		// written out rather than with complex operator*, which checks for
+		// infinities on every product
+		const double wr = twiddles[k*step].real();
+		const double wi = inverse ? -twiddles[k*step].imag() : twiddles[k*step].imag();
+		const std::complex<double> a = data[start + k];
+		const std::complex<double> x = data[start + k + half];
+		const std::complex<double> b(x.real()*wr - x.imag()*wi,x.real()*wi + x.imag()*wr);
+		data[start + k] = a + b;
+		data[start + k + half] = a - b;
+	      }
+	}
+    }
+
+    /// Bluestein's algorithm for lengths that are not powers of two
+    void bluestein(std::complex<double>* data, bool inverse) const
+    {
+      const int m = convolution->size;
+      // grown once per thread, so that repeated transforms do not allocate
+      thread_local std::vector<std::complex<double>> work;
+      if((int)work.size() < m)
+	work.resize(m);
+      std::fill(work.begin(),work.begin() + m,0.0);
+      // the inverse transform is the forward transform of the conjugate, conjugated
+      for(int k=0;k<size;k++)
+	work[k] = (inverse ? std::conj(data[k]) : data[k])*std::conj(chirp[k]);
+      convolution->forward(work.data());
+      for(int k=0;k<m;k++)
+	work[k]*=chirpSpectrum[k];
+      convolution->inverse(work.data());
+      for(int k=0;k<size;k++)
+	{
+	  const std::complex<double> x = work[k]*std::conj(chirp[k])/(double)m;
+	  data[k] = inverse ? std::conj(x) : x;
+	}
+    }
+  };
+}
+
+#endif
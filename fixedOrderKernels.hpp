@@ -0,0 +1,139 @@
+#include <array>
+#include <utility>
+#include "matrix.hpp"
+
+#ifndef FIXEDORDERKERNELS_H
+#define FIXEDORDERKERNELS_H
+
+// range of spectral orders for which kernels are instantiated; set from the
+// build with -DSCALARTOY_FIXED_ORDER_MIN/MAX
+#ifndef FIXED_ORDER_MIN
+#define FIXED_ORDER_MIN 4
+#endif
+#ifndef FIXED_ORDER_MAX
+#define FIXED_ORDER_MAX 64
+#endif
+
+//! Kernels specialised at compile time for a single spectral order
+
+//! With the order known at compile time every trip count is a constant, so the
+//! compiler can fully unroll the inner loops, vectorize them without remainder
+//! handling, and for small orders keep the whole input vector in registers
+//! across rows. A dispatch table selects the instantiation matching the order
+//! at run time.
+namespace fixedOrder{
+
+  /// number of independent partial sums in the reductions, one SIMD register
+  /// of doubles wide on AVX-512
+  const int LANES = 8;
+
+  /// dot product of two length N vectors, accumulated in LANES independent
+  /// partial sums so that the loop vectorizes without reassociation. Also
+  /// evaluates an interpolant from its precomputed boundary weights.
+  /// \param a first vector
+  /// \param b second vector
+  /// \return the dot product
+  template <int N>
+  inline double dot(const double* __restrict a, const double* __restrict b)
+  {
+    constexpr int NB = (N/LANES)*LANES;
+    double acc[LANES] = {};
+    for(int j=0;j<NB;j+=LANES)
+      for(int k=0;k<LANES;k++)
+	acc[k]+=a[j + k]*b[j + k];
+    double sum=0;
+    for(int k=0;k<LANES;k++)
+      sum+=acc[k];
+    for(int j=NB;j<N;j++)
+      sum+=a[j]*b[j];
+    return sum;
+  }
+
+  /// The products of one operator with both fields of a domain, computed in a
+  /// single pass over the operator, optionally with the DG lift of the flux
+  /// jumps folded in: out1 = D*in1 + jumps[0]*liftR - jumps[1]*liftL and
+  /// out2 = D*in2 + jumps[2]*liftR - jumps[3]*liftL, where the lift vectors
+  /// are the boundary interpolants already divided by the quadrature weights.
+  /// Each row of D is loaded once for both fields, so at orders where D no
+  /// longer fits in cache the operator traffic is halved. Instantiated with
+  /// N = 0 it serves any order n.
+  /// \param D pointer to the operator storage
+  /// \param ld leading dimension of the operator
+  /// \param in1 pointer to the first input vector
+  /// \param in2 pointer to the second input vector
+  /// \param out1 pointer to the first output vector, must not overlap the inputs
+  /// \param out2 pointer to the second output vector, must not overlap the inputs
+  /// \param jumps the four flux jumps, or null for no lift
+  /// \param liftR right lift vector
+  /// \param liftL left lift vector
+  /// \param n the order, used only when N is 0
+  template <int N>
+  void applyPair(const double* __restrict D, int ld, const double* __restrict in1, const double* __restrict in2,
+		 double* __restrict out1, double* __restrict out2, const double* jumps,
+		 const double* __restrict liftR, const double* __restrict liftL, int n = N)
+  {
+    const int len = N ? N : n;
+    const int NB = (len/LANES)*LANES;
+    for(int i=0;i<len;i++)
+      {
+	const double* row = D + (size_t)i*ld;
+	double acc1[LANES] = {}, acc2[LANES] = {};
+	for(int j=0;j<NB;j+=LANES)
+	  for(int k=0;k<LANES;k++)
+	    {
+	      acc1[k]+=row[j + k]*in1[j + k];
+	      acc2[k]+=row[j + k]*in2[j + k];
+	    }
+	double sum1=0, sum2=0;
+	for(int k=0;k<LANES;k++)
+	  {
+	    sum1+=acc1[k];
+	    sum2+=acc2[k];
+	  }
+	for(int j=NB;j<len;j++)
+	  {
+	    sum1+=row[j]*in1[j];
+	    sum2+=row[j]*in2[j];
+	  }
+	if(jumps)
+	  {
+	    sum1+=jumps[0]*liftR[i] - jumps[1]*liftL[i];
+	    sum2+=jumps[2]*liftR[i] - jumps[3]*liftL[i];
+	  }
+	out1[i] = sum1;
+	out2[i] = sum2;
+      }
+  }
+
+  typedef double (*dotKernel)(const double*, const double*); ///< signature of dot
+  typedef void (*pairKernel)(const double*, int, const double*, const double*, double*, double*, const double*,
+			     const double*, const double*, int); ///< signature of applyPair
+
+  /// the kernels instantiated for one order
+  struct kernels
+  {
+    dotKernel dot; ///< boundary interpolation
+    pairKernel applyPair; ///< fused products with both fields, with optional DG lift
+  };
+
+  /// builds the dispatch table of every instantiated order
+  template <int... I>
+  std::array<kernels,sizeof...(I)> makeTable(std::integer_sequence<int,I...>)
+  {
+    return {{ kernels{&dot<FIXED_ORDER_MIN + I>,&applyPair<FIXED_ORDER_MIN + I>}... }};
+  }
+
+  /// looks up the kernels for an order
+  /// \param order the spectral order
+  /// \return the kernels for that order, or nullptr if it was not instantiated
+  inline const kernels* lookup(int order)
+  {
+    static const std::array<kernels,FIXED_ORDER_MAX - FIXED_ORDER_MIN + 1> table =
+      makeTable(std::make_integer_sequence<int,FIXED_ORDER_MAX - FIXED_ORDER_MIN + 1>());
+    if(order < FIXED_ORDER_MIN || order > FIXED_ORDER_MAX)
+      return nullptr;
+    return &table[order - FIXED_ORDER_MIN];
+  }
+}
+
+#endif
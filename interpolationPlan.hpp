@@ -0,0 +1,102 @@
+#include <vector>
+#include <memory>
+#include "matrix.hpp"
+#include "spectralBasis.hpp"
+#include "scalarFunction.hpp"
+
+#ifndef INTERPOLATIONPLAN_H
+#define INTERPOLATIONPLAN_H
+
+/// Precomputed interpolation to a fixed set of points
+
+/// Holds the m x n barycentric interpolation and differentiation matrices from
+/// the collocation points of a basis to a fixed set of target points, such as
+/// a plot grid or probe locations, so that evaluating a function there every
+/// frame is a single matrix product instead of m barycentric sums. Off the
+/// nodes the rows are \f$\ell_j(x) = \frac{b_j/(x - x_j)}{\sum_k b_k/(x -
+/// x_k)}\f$ and \f$\ell_j^\prime(x) = \ell_j(x) \left(\sum_k \frac{\ell_k(x)}{x -
+/// x_k} - \frac{1}{x - x_j}\right)\f$; a target that coincides with a node gets
+/// the unit row and that node's row of the derivative matrix instead.
+class interpolationPlan
+{
+public:
+  int m; ///< number of target points
+  int n; ///< number of collocation points
+  std::vector<double> points; ///< the target points
+
+  /// Builds the matrices for a basis and a set of target points
+  /// \param basis the basis whose collocation values will be interpolated
+  /// \param targets the target points
+  interpolationPlan(std::shared_ptr<spectralBasis> basis, const std::vector<double> &targets)
+    : m(targets.size()), n(basis->n), points(targets), ld(matrix<double>::paddedExtent(targets.size())),
+      valuesT((size_t)basis->n*ld,0.0), derivsT((size_t)basis->n*ld,0.0)
+  {
+    const std::vector<double> &x = *basis->abscissas;
+    const std::vector<double> &b = *basis->baryWeights;
+    const matrix<double> &D = *basis->DMat;
+    std::vector<double> l(n);
+    for(int p=0;p<m;p++)
+      {
+	const double t = points[p];
+	int node = -1;
+	for(int j=0;j<n;j++)
+	  if(t == x[j])
+	    node = j;
+	if(node >= 0)
+	  {
+	    valuesT[(size_t)node*ld + p] = 1.0;
+	    for(int j=0;j<n;j++)
+	      derivsT[(size_t)j*ld + p] = D[node][j];
+	    continue;
+	  }
+	double sum = 0;
+	for(int j=0;j<n;j++)
+	  {
+	    l[j] = b[j]/(t - x[j]);
+	    sum+=l[j];
+	  }
+	double slope = 0;
+	for(int j=0;j<n;j++)
+	  {
+	    l[j]/=sum;
+	    slope+=l[j]/(t - x[j]);
+	  }
+	for(int j=0;j<n;j++)
+	  {
+	    valuesT[(size_t)j*ld + p] = l[j];
+	    derivsT[(size_t)j*ld + p] = l[j]*(slope - 1.0/(t - x[j]));
+	  }
+      }
+  }
+
+  /// Interpolates a block of nodal vectors to the target points in one
+  /// matrix product. Each row of the block is one vector of n collocation
+  /// values, such as one snapshot of a history.
+  /// \param nodal pointer to the collocation values, count rows of n
+  /// \param ldNodal distance between rows of nodal
+  /// \param out pointer to the interpolated values, populated as return parameter, count rows of m
+  /// \param ldOut distance between rows of out
+  /// \param count number of rows
+  /// \param derivative 0 for values, 1 for first derivatives
+  void apply(const double* nodal, int ldNodal, double* out, int ldOut, int count, int derivative = 0) const
+  {
+    const alignedVector<double> &op = derivative ? derivsT : valuesT;
+    matrixKernels::gemm(count,m,n,1.0,nodal,ldNodal,op.data(),ld,0.0,out,ldOut);
+  }
+
+  /// Interpolates a function to the target points
+  /// \param f the function, on the basis the plan was built for
+  /// \param out pointer to the m interpolated values, populated as return parameter
+  /// \param derivative 0 for values, 1 for first derivatives
+  void apply(const scalarFunction &f, double* out, int derivative = 0) const
+  {
+    apply(f.collocationData.data(),n,out,m,1,derivative);
+  }
+
+private:
+  int ld; ///< padded row length of the transposed matrices
+  alignedVector<double> valuesT; ///< the interpolation matrix, transposed to n rows of m
+  alignedVector<double> derivsT; ///< the differentiation matrix, transposed to n rows of m
+};
+
+#endif
@@ -1,7 +1,8 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
-#include <boost/math/special_functions/legendre.hpp>
+#include <utility>
+#include <tuple>
 #include <boost/math/tools/roots.hpp>
 #include <math.h>
 #include "matrix.hpp"
@@ -16,30 +17,253 @@ const int PREC = 50;
 //! Tools for Legendre polynomials, and corresponding spectral quantities
 namespace legendreTools{
 
+  /// Evaluates the Legendre polynomials of every order up to n at a point, with
+  /// their first and second derivatives, in a single pass of the three-term
+  /// recurrence \f$(k+1) P_{k+1} = (2k+1) x P_k - k P_{k-1}\f$. The derivatives
+  /// come from \f$P_{k+1}^\prime = P_{k-1}^\prime + (2k+1) P_k\f$ and its
+  /// derivative, which never divide by \f$x^2 - 1\f$ and so stay exact at +/-1.
+  /// \param n the highest order to evaluate
+  /// \param x the point at which to evaluate
+  /// \param P populated with \f$P_0(x) \ldots P_n(x)\f$, length n+1
+  /// \param dP if not null, populated with \f$P_0^\prime(x) \ldots P_n^\prime(x)\f$
+  /// \param ddP if not null, populated with \f$P_0^{\prime\prime}(x) \ldots P_n^{\prime\prime}(x)\f$
+  /// \sa legendreAllBatch
+  static void legendreAll(int n, double x, double* P, double* dP = nullptr, double* ddP = nullptr)
+  {
+    P[0] = 1.0;
+    if(dP) dP[0] = 0.0;
+    if(ddP) ddP[0] = 0.0;
+    if(n < 1)
+      return;
+    P[1] = x;
+    if(dP) dP[1] = 1.0;
+    if(ddP) ddP[1] = 0.0;
+    for(int k=1;k<n;k++)
+      {
+	P[k+1] = ((2*k + 1)*x*P[k] - k*P[k-1])/(k + 1);
+	if(dP) dP[k+1] = dP[k-1] + (2*k + 1)*P[k];
+	if(ddP) ddP[k+1] = ddP[k-1] + (2*k + 1)*dP[k];
+      }
+  }
+
+  /// Evaluates the Legendre polynomials of every order up to n, with their
+  /// first and second derivatives, at many points at once. The recurrence of
+  /// legendreAll runs across the points in the inner loop, which vectorizes.
+  /// Results are stored order-major: the value of order k at point j is at
+  /// index k*m + j.
+  /// \param n the highest order to evaluate
+  /// \param xs pointer to the points, length m
+  /// \param m number of points
+  /// \param P populated with the polynomial values, length (n+1)*m
+  /// \param dP if not null, populated with the first derivatives, length (n+1)*m
+  /// \param ddP if not null, populated with the second derivatives, length (n+1)*m; requires dP
+  /// \sa legendreAll
+  static void legendreAllBatch(int n, const double* __restrict xs, size_t m, double* __restrict P,
+			       double* __restrict dP = nullptr, double* __restrict ddP = nullptr)
+  {
+    for(size_t j=0;j<m;j++)
+      P[j] = 1.0;
+    if(n >= 1)
+      for(size_t j=0;j<m;j++)
+	P[m + j] = xs[j];
+    for(int k=1;k<n;k++)
+      {
+	const double a = (2*k + 1)/(double)(k + 1);
+	const double b = k/(double)(k + 1);
+	const double* __restrict p0 = P + (k - 1)*m;
+	const double* __restrict p1 = P + k*m;
+	double* __restrict p2 = P + (k + 1)*m;
+	for(size_t j=0;j<m;j++)
+	  p2[j] = a*xs[j]*p1[j] - b*p0[j];
+      }
+    if(!dP)
+      return;
+    std::fill(dP,dP + m,0.0);
+    if(n >= 1)
+      std::fill(dP + m,dP + 2*m,1.0);
+    for(int k=1;k<n;k++)
+      for(size_t j=0;j<m;j++)
+	dP[(k + 1)*m + j] = dP[(k - 1)*m + j] + (2*k + 1)*P[k*m + j];
+    if(!ddP)
+      return;
+    std::fill(ddP,ddP + std::min<size_t>(n + 1,2)*m,0.0);
+    for(int k=1;k<n;k++)
+      for(size_t j=0;j<m;j++)
+	ddP[(k + 1)*m + j] = ddP[(k - 1)*m + j] + (2*k + 1)*dP[k*m + j];
+  }
+
+  /// Value and derivatives of a single Legendre polynomial at a point, by the
+  /// recurrences of legendreAll with O(1) storage
+  /// \param n the order of Legendre polynomial to evaluate
+  /// \param x the point at which to evaluate
+  /// \param p populated with \f$P_n(x)\f$
+  /// \param dp populated with \f$P_n^\prime(x)\f$
+  /// \param ddp populated with \f$P_n^{\prime\prime}(x)\f$
+  /// \param pPrev if not null, populated with \f$P_{n-1}(x)\f$ (0 for n = 0)
+  static void legendreValues(int n, double x, double &p, double &dp, double &ddp, double* pPrev = nullptr)
+  {
+    double p0 = 0, p1 = 1.0, d0 = 0, d1 = 0, dd0 = 0, dd1 = 0;
+    if(n >= 1)
+      {
+	p0 = 1.0; p1 = x;
+	d0 = 0.0; d1 = 1.0;
+      }
+    for(int k=1;k<n;k++)
+      {
+	double p2 = ((2*k + 1)*x*p1 - k*p0)/(k + 1);
+	double d2 = d0 + (2*k + 1)*p1;
+	double dd2 = dd0 + (2*k + 1)*d1;
+	p0 = p1; p1 = p2;
+	d0 = d1; d1 = d2;
+	dd0 = dd1; dd1 = dd2;
+      }
+    p = p1;
+    dp = d1;
+    ddp = dd1;
+    if(pPrev)
+      *pPrev = p0;
+  }
+
+  /// Sums a Legendre series \f$f(x) = \sum_{k<n} c_k P_k(x)\f$ and its first two
+  /// derivatives at a point by Clenshaw's recurrence
+  /// \f$b_k = c_k + \alpha_k b_{k+1} + \beta_{k+1} b_{k+2}\f$, with
+  /// \f$\alpha_k = \frac{(2k+1)x}{k+1}\f$ and \f$\beta_k = -\frac{k}{k+1}\f$, so that
+  /// \f$f = b_0\f$. The derivatives follow from differentiating the recurrence
+  /// in x. O(n) per point with no temporary storage.
+  /// \param c pointer to the coefficients
+  /// \param n number of coefficients
+  /// \param x the point at which to evaluate
+  /// \param f populated with \f$f(x)\f$
+  /// \param df populated with \f$f^\prime(x)\f$
+  /// \param ddf populated with \f$f^{\prime\prime}(x)\f$
+  /// \sa clenshawBatch
+  static void clenshaw(const double* c, int n, double x, double &f, double &df, double &ddf)
+  {
+    double b1 = 0, b2 = 0, d1 = 0, d2 = 0, dd1 = 0, dd2 = 0;
+    for(int k=n-1;k>=0;k--)
+      {
+	const double da = (2*k + 1)/(double)(k + 1);
+	const double beta = -(k + 1)/(double)(k + 2);
+	const double a = da*x;
+	double dd0 = a*dd1 + 2*da*d1 + beta*dd2;
+	double d0 = a*d1 + da*b1 + beta*d2;
+	double b0 = c[k] + a*b1 + beta*b2;
+	b2 = b1; b1 = b0;
+	d2 = d1; d1 = d0;
+	dd2 = dd1; dd1 = dd0;
+      }
+    f = b1;
+    df = d1;
+    ddf = dd1;
+  }
+
+  /// Sums a Legendre series at a point by Clenshaw's recurrence, value only
+  /// \param c pointer to the coefficients
+  /// \param n number of coefficients
+  /// \param x the point at which to evaluate
+  /// \return \f$\sum_{k<n} c_k P_k(x)\f$
+  /// \sa clenshaw
+  static double clenshaw(const double* c, int n, double x)
+  {
+    double b1 = 0, b2 = 0;
+    for(int k=n-1;k>=0;k--)
+      {
+	double b0 = c[k] + (2*k + 1)/(double)(k + 1)*x*b1 - (k + 1)/(double)(k + 2)*b2;
+	b2 = b1;
+	b1 = b0;
+      }
+    return b1;
+  }
+
+  /// Sums a Legendre series, or one of its first two derivatives, at many
+  /// points by Clenshaw's recurrence. Points are processed in blocks whose
+  /// recurrence state lives in small fixed arrays, so the loop over a block
+  /// vectorizes across points; blocks of 32 keep several independent vector
+  /// chains in flight, where 8 leaves the recurrence latency bound.
+  /// \param c pointer to the coefficients
+  /// \param n number of coefficients
+  /// \param xs pointer to the points
+  /// \param out populated with the values at the points
+  /// \param m number of points
+  /// \param derivative 0 for the value, 1 or 2 for the first or second derivative
+  /// \sa clenshaw
+  static void clenshawBatch(const double* __restrict c, int n, const double* __restrict xs, double* __restrict out,
+			    size_t m, int derivative = 0)
+  {
+    const size_t B = 32;
+    for(size_t start=0;start<m;start+=B)
+      {
+	const size_t len = std::min(B,m - start);
+	double x[B] = {}, b1[B] = {}, b2[B] = {}, d1[B] = {}, d2[B] = {}, dd1[B] = {}, dd2[B] = {};
+	for(size_t j=0;j<len;j++)
+	  x[j] = xs[start + j];
+	for(int k=n-1;k>=0;k--)
+	  {
+	    const double da = (2*k + 1)/(double)(k + 1);
+	    const double beta = -(k + 1)/(double)(k + 2);
+	    const double ck = c[k];
+	    if(derivative >= 2)
+	      for(size_t j=0;j<B;j++)
+		{
+		  double dd0 = da*x[j]*dd1[j] + 2*da*d1[j] + beta*dd2[j];
+		  dd2[j] = dd1[j];
+		  dd1[j] = dd0;
+		}
+	    if(derivative >= 1)
+	      for(size_t j=0;j<B;j++)
+		{
+		  double d0 = da*x[j]*d1[j] + da*b1[j] + beta*d2[j];
+		  d2[j] = d1[j];
+		  d1[j] = d0;
+		}
+	    for(size_t j=0;j<B;j++)
+	      {
+		double b0 = ck + da*x[j]*b1[j] + beta*b2[j];
+		b2[j] = b1[j];
+		b1[j] = b0;
+	      }
+	  }
+	const double* result = (derivative == 0) ? b1 : (derivative == 1) ? d1 : dd1;
+	for(size_t j=0;j<len;j++)
+	  out[start + j] = result[j];
+      }
+  }
+
+  /// Value of a particular Legendre polynomial at a point
+  /// \param n the order of Legendre polynomial to evaluate
+  /// \param x the point at which to evaluate the polynomial
+  /// \return \f$P_n(x)\f$, from the three-term recurrence
+  static double legendreP(const int n, const double x)
+  {
+    double p,dp,ddp;
+    legendreValues(n,x,p,dp,ddp);
+    return p;
+  }
+
   /// Value of the first derivative of a particular Legendre polynomial order at a particular point
   /// \param n the order of Legendre polynomial to evaluate
   /// \param x the point at which to evaluate the derivative
-  /// \return the first derivative, evaluated from the analytic formula associated with legendre polys
-  ///         \f$P_n^\prime(x) = n \frac{x P_n(x) - P_{n-1}(x)}{x^2 - 1}\f$
+  /// \return the first derivative, from the recurrence \f$P_{k+1}^\prime = P_{k-1}^\prime + (2k+1) P_k\f$,
+  ///         which unlike the closed form is exact at +/-1
   /// \sa legendreDDeriv
   static double legendreDeriv(const int n, const double x)
   {
-    if(n==0)
-      return 0;
-    else
-      return n*(x* boost::math::legendre_p(n,x) - boost::math::legendre_p(n-1,x))/(pow(x,2) - 1);
+    double p,dp,ddp;
+    legendreValues(n,x,p,dp,ddp);
+    return dp;
   }
 
   /// Value of the second derivative of a particular Legendre polynomial order at a particular point
   /// \param n the order of Legendre polynomial to evaluate
   /// \param x the point at which to evaluate the second derivative
-  /// \return the first derivative, evaluated from the analytic formula associated with legendre polys
-  ///         \f$P_n^{\prime\prime}(x) = n\frac{((n - 1) x^2 - n - 1)P_n(x) + 2 x P_{n - 1}(x)}{(x^2 - 1)^2}\f$
+  /// \return the second derivative, from the differentiated recurrence
+  ///         \f$P_{k+1}^{\prime\prime} = P_{k-1}^{\prime\prime} + (2k+1) P_k^\prime\f$
   /// \sa legendreDeriv
   static double legendreDDeriv(int n, double x)
   {
-    return n*((((n - 1)* pow(x,2) - n - 1) *  boost::math::legendre_p(n,x) + 2 * x * boost::math::legendre_p(n-1,x))
-	       /pow(pow(x,2) - 1,2));
+    double p,dp,ddp;
+    legendreValues(n,x,p,dp,ddp);
+    return ddp;
   }
 
 
@@ -61,14 +285,15 @@ namespace legendreTools{
     /// \return A two-element tuple of doubles, first element is the value of the polynomial,
     ///         second element is the value of the first derivative \f$(P_n(x),P^\prime_n(x))\f$
     std::tuple<double,double> operator()(const double x){
-      return std::make_tuple<double,double>(boost::math::legendre_p(n,x),
-					    legendreDeriv(n,x));}
+      double p,dp,ddp;
+      legendreValues(n,x,p,dp,ddp);
+      return std::make_tuple(p,dp);}
 
     /// Value of the Legendre polynomial at a point
     /// \param x the point at which to evaluate the polynomial
     /// \return the value of \f$P_n(x)\f$
     double at(const double x){
-      return boost::math::legendre_p(n,x);}
+      return legendreP(n,x);}
 
     /// Value of the first derivative of the Legendre polynomial at a point
     /// \param x the point at which to evaluate the derivative
@@ -97,14 +322,17 @@ namespace legendreTools{
     /// \return A two-element tuple of doubles, first element is the value of the polynomial,
     ///         second element is the value of the first derivative \f$(q_n(x),q^\prime_n(x))\f$
     std::tuple<double,double> operator()(double x){
-      return std::make_tuple<double,double>(boost::math::legendre_p(n,x) - boost::math::legendre_p(n-2,x),
-						      legendreDeriv(n,x) -legendreDeriv(n-2,x));}
+      // with P_{n-1} and P_{n-2} from one pass, q_n^\prime = (2n-1) P_{n-1}
+      double p1,dp,ddp,p0;
+      legendreValues(n-1,x,p1,dp,ddp,&p0);
+      double p2 = ((2*n - 1)*x*p1 - (n - 1)*p0)/n;
+      return std::make_tuple(p2 - p0,(2*n - 1)*p1);}
 
     /// Value of the \f$q_n\f$ polynomial at a point
     /// \param x the point at which to evaluate the polynomial
     /// \return the value of \f$q_n(x)\f$
     double at(double x){
-      return boost::math::legendre_p(n,x) - boost::math::legendre_p(n-2,x);}
+      return legendreP(n,x) - legendreP(n-2,x);}
 
 
     /// Value of the first derivative of the \f$q_n\f$ polynomial at a point
@@ -112,11 +340,176 @@ namespace legendreTools{
     /// \return the value of \f$q^\prime_n(x)\f$
     /// \sa legendreDeriv    
     double dx(double x){
-      return legendreDeriv(n,x) -legendreDeriv(n-2,x);}
+      return (2*n - 1)*legendreP(n-1,x);}
   };
 
 
 
+
+  /// Orders from which the nodes and weights are generated by the O(n)
+  /// Glaser-Liu-Rokhlin march rather than by Newton-Raphson on the
+  /// three-term recurrence, which costs O(n) per evaluation and O(n^2) in total
+  const int GLR_ORDER = 32;
+
+  /// Advances a solution of \f$(1 - x^2) y^{\prime\prime} - a x y^\prime + \lambda y = 0\f$
+  /// by its Taylor series, the ODE giving every derivative through
+  /// \f$y^{(k+2)} = \frac{(2k + a) x y^{(k+1)} + (k(k-1) + a k - \lambda) y^{(k)}}{1 - x^2}\f$.
+  /// The step is split so that no substep exceeds half the distance to the
+  /// singular endpoints, keeping the series geometrically convergent. With
+  /// \f$a=2, \lambda = n(n+1)\f$ the solutions are \f$P_n\f$, with \f$a=4, \lambda =
+  /// n(n+1) - 2\f$ they are \f$P_n^\prime\f$.
+  /// \param a coefficient of the first derivative term
+  /// \param lambda coefficient of the undifferentiated term
+  /// \param x0 the point at which the solution is known
+  /// \param x1 the point to advance to
+  /// \param y the value at x0, replaced with the value at x1
+  /// \param dy the first derivative at x0, replaced with the derivative at x1
+  static void taylorMarch(double a, double lambda, long double x0, long double x1, long double &y, long double &dy)
+  {
+    long double x = x0;
+    while(x != x1)
+      {
+	// fix the end of the substep first and step by its exact distance, as
+	// near the endpoints rounding x + h would shift the solution by a
+	// relative error of order eps/(1 - x) on every substep
+	const long double limit = 0.5L*(1.0L - fabsl(x));
+	const long double next = (fabsl(x1 - x) > limit) ? ((x1 > x) ? x + limit : x - limit) : x1;
+	const long double h = next - x;
+	// scaled Taylor coefficients c_k = y^(k) h^k / k!
+	long double cPrev = y;
+	long double c = dy*h;
+	long double sum = cPrev + c;
+	long double dsum = c;
+	long double scale = std::max(fabsl(cPrev),fabsl(c));
+	const long double denom = (1.0L - x)*(1.0L + x);
+	for(int k=0;k<200;k++)
+	  {
+	    long double cNext = ((2*k + a)*x*h*c/(k + 2)
+				 + (k*(k - 1.0L) + a*k - lambda)*h*h*cPrev/((k + 1.0L)*(k + 2)))/denom;
+	    sum+=cNext;
+	    dsum+=(k + 2)*cNext;
+	    scale = std::max(scale,fabsl(cNext));
+	    if(k > 2 && fabsl(cNext) + fabsl(c) <= 1e-21L*scale)
+	      break;
+	    cPrev = c;
+	    c = cNext;
+	  }
+	y = sum;
+	dy = dsum/h;
+	x = next;
+      }
+  }
+
+  /// Generates Gauss-Legendre or Gauss-Lobatto nodes and weights in O(n) by
+  /// the method of Glaser, Liu and Rokhlin: starting from the centre, each
+  /// positive root of \f$P_n\f$ (Gauss) or \f$P_{n-1}^\prime\f$ (Gauss-Lobatto)
+  /// is found by Newton-Raphson on a Taylor series of the Legendre ODE expanded
+  /// about the previous root, with the asymptotic (Tricomi) root estimates
+  /// supplying the step. Each root costs a bounded number of series terms,
+  /// independent of n, and the negative half follows by symmetry. The
+  /// polynomial is marched in an arbitrary normalization, so the weights
+  /// \f$w_i \propto 1/((1 - x_i^2) P_n^\prime(x_i)^2)\f$, and for Gauss-Lobatto
+  /// \f$w_i \propto 1/((1 - x_i^2) P_{n-1}^{\prime\prime}(x_i))^2\f$, are scaled to
+  /// integrate a constant exactly. The march runs in long double and each
+  /// weight's derivative is carried to the exact root to first order, so the
+  /// weights stay accurate to a few ulp for n up to \f$10^5\f$.
+  /// \param order number of nodes
+  /// \param lobatto true for Gauss-Lobatto nodes, false for Gauss-Legendre
+  /// \return shared_ptrs to the ascending nodes and their weights
+  static std::pair<std::shared_ptr<std::vector<double>>,std::shared_ptr<std::vector<double>>>
+  generateGLRQuadrature(int order, bool lobatto)
+  {
+    std::shared_ptr<std::vector<double>> abscissas(new std::vector<double>(order,0.0));
+    std::shared_ptr<std::vector<double>> weights(new std::vector<double>(order,0.0));
+    // the polynomial whose roots are wanted: its degree and ODE coefficients
+    const int m = lobatto ? order - 1 : order;
+    const int degree = lobatto ? m - 1 : m;
+    const double a = lobatto ? 4.0 : 2.0;
+    const double lambda = lobatto ? m*(m + 1.0) - 2.0 : m*(m + 1.0);
+    const int roots = degree/2;
+    // first interior slot of the positive roots, ascending
+    const int first = order - roots - (lobatto ? 1 : 0);
+
+    // asymptotic estimate of the j-th positive root counted down from 1
+    auto estimate = [&](int j){
+      if(lobatto)
+	return cos((j + 0.25)*PI/m - 3.0/(8.0*m*PI*(j + 0.25)));
+      return (1.0 - 1.0/(8.0*m*m) + 1.0/(8.0*m*m*m))*cos(PI*(4.0*j - 1.0)/(4.0*m + 2.0));};
+
+    // the polynomial is odd when the degree is, with a root at the centre.
+    // The march carries on from each root as found, never reset to a rounded
+    // root, so no error enters the solution there.
+    long double x = 0.0L;
+    long double y = (degree%2) ? 0.0L : 1.0L;
+    long double dy = (degree%2) ? 1.0L : 0.0L;
+    // the unscaled interior weights, summed in long double as the scale of
+    // the whole rule rests on it
+    long double sum = 0;
+    if(degree%2)
+      {
+	weights->at(order/2) = 1.0;
+	sum = 1.0L;
+      }
+    double guessPrev = 0.0;
+    for(int r=0;r<roots;r++)
+      {
+	double guess = estimate(roots - r);
+	// step by the estimated spacing from the last accurate root, which
+	// corrects the bias of the estimates
+	long double root = (r == 0) ? guess : x + (guess - guessPrev);
+	guessPrev = guess;
+	long double ry = 0, rdy = 0;
+	long double lastStep = 1.0L;
+	for(int it=0;;it++)
+	  {
+	    ry = y;
+	    rdy = dy;
+	    taylorMarch(a,lambda,x,root,ry,rdy);
+	    const long double step = ry/rdy;
+	    if(it == 30 || !(fabsl(step) < lastStep))
+	      break;
+	    root-=step;
+	    lastStep = fabsl(step);
+	  }
+	x = root;
+	y = ry;
+	dy = rdy;
+	abscissas->at(first + r) = (double)root;
+	abscissas->at(order - 1 - first - r) = -(double)root;
+	// the weight is 1/f for Gauss and 1/f^2 for Gauss-Lobatto, with
+	// f = (1 - x^2) y^\prime^2 and (1 - x^2) y^\prime respectively. f varies on the
+	// scale of 1 - x, so near the ends even the residual s = y/y^\prime of a
+	// long double root matters: take f at the exact root to first order,
+	// f - s f^\prime, with f^\prime from the ODE
+	const long double s = ry/rdy;
+	const long double oneMinus = (1.0L - root)*(1.0L + root);
+	long double f;
+	if(lobatto)
+	  {
+	    f = oneMinus*rdy - s*(2*root*rdy - lambda*ry);
+	    f = f*f;
+	  }
+	else
+	  f = oneMinus*rdy*rdy - s*(2*root*rdy*rdy - 2*lambda*ry*rdy);
+	weights->at(first + r) = (double)(1.0L/f);
+	weights->at(order - 1 - first - r) = weights->at(first + r);
+	sum+=2.0L/f;
+      }
+
+    // scale the interior weights so the rule integrates 1 exactly
+    long double total = 2.0L;
+    if(lobatto)
+      {
+	abscissas->front() = -1.0;
+	abscissas->back() = 1.0;
+	weights->front() = weights->back() = 2.0/(order*(order - 1.0));
+	total-=2*weights->front();
+      }
+    for(int i=(lobatto ? 1 : 0);i<(lobatto ? order - 1 : order);i++)
+      weights->at(i) = (double)(weights->at(i)*(total/sum));
+    return std::make_pair(abscissas,weights);
+  }
+
   
   /// Generates the Gauss-Legendre Abscissas at a particular order in the
   /// approximation The abscissas determine the collocation points for a
@@ -125,9 +518,12 @@ namespace legendreTools{
   /// zeros of [Kopriva; Numerical Recipes] \f$P_n(x)\f$, where n is the number of
   /// spectral points
   /// \param order the order of Legendre polynomials for which to generate abscissas
+  /// \param glrOrder the order from which the O(n) generateGLRQuadrature is used instead
   /// \return a shared_ptr to the vector of abscissas \f$x_n\f$
-  static std::shared_ptr<std::vector<double>> generateAbscissas(int order){
-    std::shared_ptr<std::vector<double>> abscissas(new std::vector<double>());
+  static std::shared_ptr<std::vector<double>> generateAbscissas(int order, int glrOrder = GLR_ORDER){
+    if(order >= glrOrder)
+      return generateGLRQuadrature(order,false).first;
+    std::shared_ptr<std::vector<double>> abscissas(new std::vector<double>(order,0.0));
 
     // generate a very rough approximation for the first; working backward
     // for Newton-Raphson nextAb < ab < prevAb
@@ -140,18 +536,15 @@ namespace legendreTools{
 	nextAb= ((1 - 1/pow(order,2) + 1/pow(order,3))
 			  * cos(PI*(4*(i+1) - 1)/(4*order + 2)));
 	legendre legendreN = legendre(order);
-	abscissas->insert(abscissas->begin(),
-			  boost::math::tools::newton_raphson_iterate(legendreN,ab,
-								     nextAb,prevAb,PREC));
+	abscissas->at(order - i) = boost::math::tools::newton_raphson_iterate(legendreN,ab,
+									      nextAb,prevAb,PREC);
 	prevAb=ab;
 	ab=nextAb;
       }
 
-    // half generated, other half directly inferred
-    if(order%2 !=0)
-      abscissas->insert(abscissas->begin(),0);
+    // half generated, other half directly inferred (the centre stays 0 for odd orders)
     for(int i = 1;i<=(order/2);i++)
-	abscissas->insert(abscissas->begin()+i-1,-1*abscissas->at(abscissas->size()-i));
+      abscissas->at(i-1) = -abscissas->at(order - i);
     return abscissas;
   };
 
@@ -162,8 +555,11 @@ namespace legendreTools{
   /// evaluating pseudospectral evolution.  The abscissas are located at the
   /// zeros of [Kopriva] \f$P_n(x) - P_{n-2}(x)\f$, where n is the number of spectral points
   /// \param order the order of Legendre polynomials for which to generate abscissas
+  /// \param glrOrder the order from which the O(n) generateGLRQuadrature is used instead
   /// \return a shared_ptr to the vector of abscissas \f$x_i^n\f$
-  static std::shared_ptr<std::vector<double>> generateGLAbscissas(int order){
+  static std::shared_ptr<std::vector<double>> generateGLAbscissas(int order, int glrOrder = GLR_ORDER){
+    if(order >= glrOrder)
+      return generateGLRQuadrature(order,true).first;
     std::shared_ptr<std::vector<double>> abscissas(new std::vector<double>());
     // generate a very rough approximation for the first couple.
     // working forward, prevAb < ab < nextAb
@@ -218,7 +614,7 @@ namespace legendreTools{
     std::shared_ptr<std::vector<double>> weights(new std::vector<double>());
     weights->push_back(2.0/((double)(order*(order - 1))));
     for(int i=1;i<order-1;i++)
-      weights->push_back(2.0/((order*(order -1.0))*pow(boost::math::legendre_p(order-1,abscissas->at(i)),2)));
+      weights->push_back(2.0/((order*(order -1.0))*pow(legendreP(order-1,abscissas->at(i)),2)));
     weights->push_back(2.0/((double)(order*(order - 1))));
     return weights;
   }
@@ -248,6 +644,44 @@ namespace legendreTools{
     return weights;
   }
 
+  /// Generates Gauss-Legendre or Gauss-Lobatto abscissas together with their
+  /// weights, by Newton-Raphson below GLR_ORDER and by the O(n)
+  /// Glaser-Liu-Rokhlin march from there on
+  /// \param order number of collocation points
+  /// \param lobatto true for Gauss-Lobatto points, false for Gauss-Legendre
+  /// \return shared_ptrs to the abscissas and the weights
+  static std::pair<std::shared_ptr<std::vector<double>>,std::shared_ptr<std::vector<double>>>
+  generateQuadrature(int order, bool lobatto)
+  {
+    if(order >= GLR_ORDER)
+      return generateGLRQuadrature(order,lobatto);
+    std::shared_ptr<std::vector<double>> abscissas = lobatto ? generateGLAbscissas(order) : generateAbscissas(order);
+    return std::make_pair(abscissas,lobatto ? generateGLWeights(order,abscissas) : generateWeights(order,abscissas));
+  }
+
+  /// Generates the Barycentric Weights of Gauss-Legendre or Gauss-Lobatto
+  /// points in O(n) from their quadrature weights, up to a common factor which
+  /// cancels in every use: \f$w^{B}_i \propto (-1)^i \sqrt{(1 - x_i^2) w_i}\f$ for
+  /// Gauss-Legendre and \f$w^{B}_i \propto (-1)^i \sqrt{w_i}\f$ for Gauss-Lobatto
+  /// points. Unlike the product formula this neither under- nor overflows at
+  /// high orders.
+  /// \param order the number of points
+  /// \param abscissas a shared_ptr to the ascending abscissas
+  /// \param weights a shared_ptr to the quadrature weights of the abscissas
+  /// \param lobatto true for Gauss-Lobatto points, false for Gauss-Legendre
+  /// \return a shared_ptr to the vector of barycentric weights
+  static std::shared_ptr<std::vector<double>> generateBaryWeights(int order, std::shared_ptr<std::vector<double>> abscissas,
+								  std::shared_ptr<std::vector<double>> weights, bool lobatto)
+  {
+    std::shared_ptr<std::vector<double>> bary(new std::vector<double>(order));
+    for(int i=0;i<order;i++)
+      {
+	double x = abscissas->at(i);
+	bary->at(i) = ((i%2) ? -1.0 : 1.0)*sqrt(lobatto ? weights->at(i) : (1.0 - x*x)*weights->at(i));
+      }
+    return bary;
+  }
+
   /// Generates the matrix with which the derivatives at collocation points can
   /// be computed (either for Gauss-Legendre or Gauss-Lobatto collocation). The
   /// matrix values are computed as per [Kopriva]: \f$D_{i j}^n =
@@ -260,23 +694,22 @@ namespace legendreTools{
   static std::shared_ptr<matrix<double>> generateDMat(int order, std::shared_ptr<std::vector<double>> abscissas,
 						      std::shared_ptr<std::vector<double>> bWeights)
   {
-    std::vector<std::vector<double>> DMat;
-    for(int i=0;i<order;i++)
-	DMat.push_back(std::vector<double>(order));
-    
+    std::shared_ptr<matrix<double>> DMat(new matrix<double>(order));
+    matrix<double> &D = *DMat;
+
     for(int i=0;i<order;i++)
       {
-	DMat[i][i] = 0;
+	D[i][i] = 0;
 	for(int j=0;j<order;j++)
 	  {
 	    if(i!=j)
 	      {
-		DMat[i][j] = ((bWeights->at(j)/bWeights->at(i)) *(1.0/(abscissas->at(i) - abscissas->at(j))));
-		DMat[i][i] = (DMat[i][i] - DMat[i][j]);
+		D[i][j] = ((bWeights->at(j)/bWeights->at(i)) *(1.0/(abscissas->at(i) - abscissas->at(j))));
+		D[i][i] = (D[i][i] - D[i][j]);
 	      }
 	  }
       }
-    return std::shared_ptr<matrix<double>>(new matrix<double>(order,DMat));
+    return DMat;
   }
 }
 
@@ -0,0 +1,100 @@
+#include <vector>
+#include <type_traits>
+#include <boost/numeric/odeint.hpp>
+#include "multiDomainWave.hpp"
+
+#ifndef LOWSTORAGERK_H
+#define LOWSTORAGERK_H
+
+/// Low-storage fourth-order Runge-Kutta stepper
+
+/// The five-stage, fourth-order 2N-storage scheme of Carpenter and Kennedy
+/// (NASA TM-109112, 1994). Each stage s evaluates k = f(u, t + c_s dt), then
+/// updates du = a_s du + dt k and u += b_s du, so besides the state only the
+/// accumulator du and the derivative buffer k are kept, against the five
+/// extra state-sized vectors of odeint's runge_kutta4, at the price of a
+/// fifth right-hand side per step with a correspondingly larger stability
+/// region. On a multiDomainWave the stage update is folded into the
+/// right-hand side itself, applied to each block of domains as soon as its
+/// derivatives are final, so k is consumed while still in cache rather than
+/// in a separate pass over the whole state. It models odeint's Stepper
+/// concept, so integrate_const and the history observers work unchanged.
+class lowStorageRK
+{
+public:
+  typedef std::vector<double> state_type; ///< the flattened state
+  typedef std::vector<double> deriv_type; ///< the flattened derivatives
+  typedef double value_type; ///< scalar type of the state
+  typedef double time_type; ///< type of the time
+  typedef unsigned short order_type; ///< type of the order
+  typedef boost::numeric::odeint::stepper_tag stepper_category; ///< a plain fixed-step stepper
+
+  /// \return the order of the scheme
+  static order_type order(){
+    return 4;}
+
+  /// Advances the state by one step
+  /// \param system the right-hand side, a multiDomainWave or any odeint system, optionally wrapped by boost::ref
+  /// \param x the state, advanced in place
+  /// \param t the time at the start of the step
+  /// \param dt the time step
+  template <class System>
+  void do_step(System &&system, state_type &x, time_type t, time_type dt)
+  {
+    typedef typename boost::numeric::odeint::unwrap_reference<typename std::remove_cv<typename std::remove_reference<System>::type>::type>::type sysType;
+    sysType &sys = system;
+    if(du.size() != x.size())
+      {
+	du.assign(x.size(),0.0);
+	k.assign(x.size(),0.0);
+      }
+    for(int s=0;s<STAGES;s++)
+      step(sys,x,t + C[s]*dt,dt,s);
+  }
+
+private:
+  static const int STAGES = 5; ///< number of stages
+  static constexpr double A[STAGES] = {0.0,
+				       -567301805773.0/1357537059087.0,
+				       -2404267990393.0/2016746695238.0,
+				       -3550918686646.0/2091501179385.0,
+				       -1275806237668.0/842570457699.0}; ///< weights of the previous accumulator
+  static constexpr double B[STAGES] = {1432997174477.0/9575080441755.0,
+				       5161836677717.0/13612068292357.0,
+				       1720146321549.0/2090206949498.0,
+				       3134564353537.0/4481467310338.0,
+				       2277821191437.0/14882151754819.0}; ///< weights of the accumulator in the state update
+  static constexpr double C[STAGES] = {0.0,
+				       1432997174477.0/9575080441755.0,
+				       2526269341429.0/6820363962896.0,
+				       2006345519317.0/3224310063776.0,
+				       2802321613138.0/2924317926251.0}; ///< stage times as fractions of the step
+
+  std::vector<double> du; ///< the stage accumulator
+  std::vector<double> k; ///< the derivatives of the current stage
+
+  /// one stage, with the update folded into the right-hand side of a wave
+  /// and as a separate pass over the state for any other system
+  template <class System>
+  void step(System &sys, state_type &x, time_type t, time_type dt, int s)
+  {
+    if constexpr(std::is_base_of<multiDomainWave,System>::value)
+      {
+	sys.stage = multiDomainWave::rkStage{x.data(),du.data(),k.data(),A[s],B[s],dt};
+	sys(x,k,t);
+	sys.stage = multiDomainWave::rkStage();
+      }
+    else
+      {
+	sys(x,k,t);
+	const size_t size = x.size();
+	for(size_t i=0;i<size;i++)
+	  {
+	    du[i] = A[s]*du[i] + dt*k[i];
+	    x[i]+=B[s]*du[i];
+	  }
+      }
+  }
+};
+
+#endif
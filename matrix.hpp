@@ -2,117 +2,595 @@
 #include "math.h"
 #include <vector>
 #include <iterator>
+#include <new>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 #ifndef MATRIX
 #define MATRIX
 
 
+/// Allocator returning storage aligned to a fixed byte boundary, so that matrix
+/// rows start on cache-line (and SIMD register) boundaries
+template <class T, size_t Align = 64>
+struct alignedAllocator
+{
+  typedef T value_type; ///< allocated type
+
+  /// rebinding helper required by allocator-aware containers
+  template <class U>
+  struct rebind{ typedef alignedAllocator<U,Align> other;};
+
+  alignedAllocator(){}
+
+  template <class U>
+  alignedAllocator(const alignedAllocator<U,Align> &){}
+
+  /// allocates aligned storage for N objects
+  /// \param N number of objects
+  T* allocate(size_t N){
+    return static_cast<T*>(::operator new(N*sizeof(T),std::align_val_t(Align)));}
+
+  /// releases storage obtained from allocate
+  /// \param p pointer returned by allocate
+  void deallocate(T* p, size_t){
+    ::operator delete(p,std::align_val_t(Align));}
+
+  template <class U>
+  bool operator ==(const alignedAllocator<U,Align> &) const{
+    return true;}
+
+  template <class U>
+  bool operator !=(const alignedAllocator<U,Align> &) const{
+    return false;}
+};
+
+/// vector type with 64-byte aligned storage
+template <class T>
+using alignedVector = std::vector<T,alignedAllocator<T>>;
+
+
+/// Lightweight view of a single row of a matrix, valid as long as the matrix
+/// storage it refers to is not resized
+template <class T>
+struct matrixRow
+{
+  T* rowData; ///< pointer to the first entry of the row
+  int extent; ///< number of entries in the row
+
+  /// access an entry of the row
+  /// \param j column index
+  T& operator[](int j) const{
+    return rowData[j];}
+
+  /// returns a pointer to the first entry of the row
+  T* begin() const{
+    return rowData;}
+
+  /// returns a pointer past the last entry of the row
+  T* end() const{
+    return rowData + extent;}
+};
+
+
+//! Dense linear algebra kernels operating on raw row-major storage
+namespace matrixKernels{
+
+  /// General matrix multiply on row-major storage, C = alpha*A*B + beta*C, for
+  /// element types without a dedicated kernel. A is MxK, B is KxN, C is MxN.
+  /// \param M rows of A and C
+  /// \param N columns of B and C
+  /// \param K columns of A and rows of B
+  /// \param alpha scaling of the product
+  /// \param A pointer to A, rows separated by lda
+  /// \param lda leading dimension of A
+  /// \param B pointer to B, rows separated by ldb
+  /// \param ldb leading dimension of B
+  /// \param beta scaling of the existing C
+  /// \param C pointer to C, rows separated by ldc
+  /// \param ldc leading dimension of C
+  template <class T>
+  void gemm(int M, int N, int K, T alpha, const T* A, int lda, const T* B, int ldb,
+	    T beta, T* C, int ldc)
+  {
+    for(int i=0;i<M;i++)
+      {
+	T* c = C + (size_t)i*ldc;
+	for(int j=0;j<N;j++)
+	  c[j] = (beta == T(0)) ? T(0) : beta*c[j];
+	for(int k=0;k<K;k++)
+	  {
+	    const T aik = alpha*A[(size_t)i*lda + k];
+	    const T* b = B + (size_t)k*ldb;
+	    for(int j=0;j<N;j++)
+	      c[j]+=aik*b[j];
+	  }
+      }
+  }
+
+  // register block (MR x NR micro-tile) for the double precision kernel,
+  // chosen per instruction set so that the accumulators fill the register file
+#if defined(__AVX512F__)
+  const int MR = 8; ///< rows of the micro-tile
+  const int NR = 16; ///< columns of the micro-tile
+#elif defined(__AVX2__) && defined(__FMA__)
+  const int MR = 6; ///< rows of the micro-tile
+  const int NR = 8; ///< columns of the micro-tile
+#else
+  const int MR = 4; ///< rows of the micro-tile
+  const int NR = 4; ///< columns of the micro-tile
+#endif
+  const int KC = 256; ///< depth of a packed panel, sized so an A and B sliver stay in L1
+  const int MC = 96; ///< rows of a packed A block, sized to stay in L2
+  const int NC = 2048; ///< columns of a packed B block
+
+  /// per-thread packing buffers, grown on first use and then reused
+  struct packBuffers
+  {
+    alignedVector<double> A; ///< packed MC x KC block of A
+    alignedVector<double> B; ///< packed KC x NC block of B
+  };
+
+  /// the packing buffers of the calling thread
+  inline packBuffers& threadPackBuffers(){
+    static thread_local packBuffers buffers;
+    return buffers;}
+
+  /// grows the calling thread's packing buffers to hold the largest blocks used
+  /// by gemm, so that subsequent products perform no heap allocation
+  inline void reservePacking()
+  {
+    packBuffers &buf = threadPackBuffers();
+    if(buf.A.size() < (size_t)(MC + MR)*KC)
+      buf.A.resize((size_t)(MC + MR)*KC);
+    if(buf.B.size() < (size_t)(NC + NR)*KC)
+      buf.B.resize((size_t)(NC + NR)*KC);
+  }
+
+  /// packs an mc x kc block of A into consecutive MR-row slivers, each stored
+  /// column by column and zero-padded to a full MR rows
+  inline void packA(int mc, int kc, const double* A, int lda, double alpha, double* packed)
+  {
+    for(int i0=0;i0<mc;i0+=MR)
+      {
+	const int rows = std::min(MR,mc - i0);
+	for(int k=0;k<kc;k++)
+	  {
+	    for(int r=0;r<rows;r++)
+	      packed[r] = alpha*A[(size_t)(i0 + r)*lda + k];
+	    for(int r=rows;r<MR;r++)
+	      packed[r] = 0;
+	    packed+=MR;
+	  }
+      }
+  }
+
+  /// packs a kc x nc block of B into consecutive NR-column slivers, each stored
+  /// row by row and zero-padded to a full NR columns
+  inline void packB(int kc, int nc, const double* B, int ldb, double* packed)
+  {
+    for(int j0=0;j0<nc;j0+=NR)
+      {
+	const int cols = std::min(NR,nc - j0);
+	for(int k=0;k<kc;k++)
+	  {
+	    const double* b = B + (size_t)k*ldb + j0;
+	    for(int c=0;c<cols;c++)
+	      packed[c] = b[c];
+	    for(int c=cols;c<NR;c++)
+	      packed[c] = 0;
+	    packed+=NR;
+	  }
+      }
+  }
+
+  /// computes the full MR x NR product of one packed A sliver and one packed B
+  /// sliver over depth kc, storing it row-major into tile
+  inline void microKernel(int kc, const double* __restrict a, const double* __restrict b,
+			  double* __restrict tile)
+  {
+#if defined(__AVX512F__)
+    __m512d c[MR][2];
+    for(int r=0;r<MR;r++)
+      c[r][0] = c[r][1] = _mm512_setzero_pd();
+    for(int k=0;k<kc;k++)
+      {
+	const __m512d b0 = _mm512_load_pd(b);
+	const __m512d b1 = _mm512_load_pd(b + 8);
+	for(int r=0;r<MR;r++)
+	  {
+	    const __m512d ar = _mm512_set1_pd(a[r]);
+	    c[r][0] = _mm512_fmadd_pd(ar,b0,c[r][0]);
+	    c[r][1] = _mm512_fmadd_pd(ar,b1,c[r][1]);
+	  }
+	a+=MR;
+	b+=NR;
+      }
+    for(int r=0;r<MR;r++)
+      {
+	_mm512_store_pd(tile + r*NR,c[r][0]);
+	_mm512_store_pd(tile + r*NR + 8,c[r][1]);
+      }
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256d c[MR][2];
+    for(int r=0;r<MR;r++)
+      c[r][0] = c[r][1] = _mm256_setzero_pd();
+    for(int k=0;k<kc;k++)
+      {
+	const __m256d b0 = _mm256_load_pd(b);
+	const __m256d b1 = _mm256_load_pd(b + 4);
+	for(int r=0;r<MR;r++)
+	  {
+	    const __m256d ar = _mm256_broadcast_sd(a + r);
+	    c[r][0] = _mm256_fmadd_pd(ar,b0,c[r][0]);
+	    c[r][1] = _mm256_fmadd_pd(ar,b1,c[r][1]);
+	  }
+	a+=MR;
+	b+=NR;
+      }
+    for(int r=0;r<MR;r++)
+      {
+	_mm256_store_pd(tile + r*NR,c[r][0]);
+	_mm256_store_pd(tile + r*NR + 4,c[r][1]);
+      }
+#else
+    double c[MR][NR] = {};
+    for(int k=0;k<kc;k++)
+      {
+	for(int r=0;r<MR;r++)
+	  for(int j=0;j<NR;j++)
+	    c[r][j]+=a[r]*b[j];
+	a+=MR;
+	b+=NR;
+      }
+    for(int r=0;r<MR;r++)
+      for(int j=0;j<NR;j++)
+	tile[r*NR + j] = c[r][j];
+#endif
+  }
+
+  /// General matrix multiply on row-major double storage, C = alpha*A*B +
+  /// beta*C. Blocks C into MC x NC panels with depth KC, packs the operands
+  /// into contiguous slivers, and computes each MR x NR tile in registers with
+  /// the widest FMA instructions the build targets (AVX-512, AVX2, or a
+  /// portable scalar fallback). C must not overlap A or B.
+  /// \param M rows of A and C
+  /// \param N columns of B and C
+  /// \param K columns of A and rows of B
+  /// \param alpha scaling of the product
+  /// \param A pointer to A, rows separated by lda
+  /// \param lda leading dimension of A
+  /// \param B pointer to B, rows separated by ldb
+  /// \param ldb leading dimension of B
+  /// \param beta scaling of the existing C
+  /// \param C pointer to C, rows separated by ldc
+  /// \param ldc leading dimension of C
+  inline void gemm(int M, int N, int K, double alpha, const double* A, int lda, const double* B, int ldb,
+		   double beta, double* C, int ldc)
+  {
+    if(K == 0 || alpha == 0)
+      {
+	for(int i=0;i<M;i++)
+	  for(int j=0;j<N;j++)
+	    C[(size_t)i*ldc + j] = (beta == 0) ? 0 : beta*C[(size_t)i*ldc + j];
+	return;
+      }
+    reservePacking();
+    packBuffers &buf = threadPackBuffers();
+    alignas(64) double tile[MR*NR];
+    for(int j0=0;j0<N;j0+=NC)
+      {
+	const int nc = std::min(NC,N - j0);
+	for(int k0=0;k0<K;k0+=KC)
+	  {
+	    const int kc = std::min(KC,K - k0);
+	    // only the first pass over the depth scales the existing C
+	    const double blockBeta = (k0 == 0) ? beta : 1.0;
+	    packB(kc,nc,B + (size_t)k0*ldb + j0,ldb,buf.B.data());
+	    for(int i0=0;i0<M;i0+=MC)
+	      {
+		const int mc = std::min(MC,M - i0);
+		packA(mc,kc,A + (size_t)i0*lda + k0,lda,alpha,buf.A.data());
+		for(int jr=0;jr<nc;jr+=NR)
+		  {
+		    const int cols = std::min(NR,nc - jr);
+		    for(int ir=0;ir<mc;ir+=MR)
+		      {
+			const int rows = std::min(MR,mc - ir);
+			microKernel(kc,buf.A.data() + (size_t)ir*kc,buf.B.data() + (size_t)jr*kc,tile);
+			for(int r=0;r<rows;r++)
+			  {
+			    double* c = C + (size_t)(i0 + ir + r)*ldc + j0 + jr;
+			    const double* t = tile + r*NR;
+			    if(blockBeta == 0)
+			      for(int j=0;j<cols;j++)
+				c[j] = t[j];
+			    else if(blockBeta == 1)
+			      for(int j=0;j<cols;j++)
+				c[j]+= t[j];
+			    else
+			      for(int j=0;j<cols;j++)
+				c[j] = blockBeta*c[j] + t[j];
+			  }
+		      }
+		  }
+	      }
+	  }
+      }
+  }
+}
+
+
 /// Class representing a matrix supporting simple multiplication and
-/// multiplication with vector types
+/// multiplication with vector types. Entries are stored row-major in a single
+/// 64-byte aligned buffer, with each row padded out to a multiple of the cache
+/// line so that every row starts aligned.
 template <class T>
 class matrix
 {
 public:
-  std::vector<std::vector<T>> matData;///< The storage for the NxN matrix
+  alignedVector<T> matData;///< The storage for the NxN matrix, extent rows each of length ld
   int extent; ///< Size of each dimension of the square matrix
+  int ld; ///< leading dimension: the padded length of each row in matData
 
   /// initializes an empty matrix of size NxN
   /// \param N size of the matrix
   matrix(size_t N)
-  {
-    extent=N;
-    matData = std::vector<std::vector<T>>(N,std::vector<T>(N));
-  }
+    : matData(N*paddedExtent(N)), extent(N), ld(paddedExtent(N)) {}
 
   /// initializes a diagonal matrix of size NxN with value T on the diagonal
   /// \param N extent of matrix
   /// \param val value on the diagonal
   matrix(size_t N, T val)
+    : matrix(N)
   {
-    extent=N;
-    matData = std::vector<std::vector<T>>(N,std::vector<T>(N));
     for(int i=0;i<extent;i++)
-      for(int j=0;j<extent;j++)
-	i==j ? matData[i][j]=val : matData[i][j]=0;
+      (*this)[i][i]=val;
   }
 
   /// initalizes a diagonal matrix of size NxN with a full initial matrix
   /// \param N extent of matrix
   /// \param initial data to be copied to the internal matrix data
-  matrix(size_t N, std::vector<std::vector<T>> initial)
-    : extent(N), matData(initial) {}
-
-  /// returns the iterator begin of the interior data type
-  auto begin(){
-    return matData.begin();}
-
-  /// returns the iterator end of the interior data type
-  auto end(){
-    return matData.end();}
-  
-  /// extracts the vector at a particular row
+  matrix(size_t N, const std::vector<std::vector<T>> &initial)
+    : matrix(N)
+  {
+    for(int i=0;i<extent;i++)
+      std::copy(initial[i].begin(),initial[i].begin()+extent,(*this)[i].begin());
+  }
+
+  /// the padded row length used for a matrix of size N, a whole number of
+  /// 64-byte cache lines
+  /// \param N extent of matrix
+  static int paddedExtent(size_t N){
+    const size_t perLine = 64/sizeof(T) > 0 ? 64/sizeof(T) : 1;
+    return (int)(((N + perLine - 1)/perLine)*perLine);}
+
+  /// returns a pointer to the start of the (padded) row-major storage
+  T* data(){
+    return matData.data();}
+
+  /// returns a pointer to the start of the (padded) row-major storage
+  const T* data() const{
+    return matData.data();}
+
+  /// extracts a view of the row at a particular row
   /// \param i row to extract
-  std::vector<T> operator[](int i){
-    return matData[i];}
+  matrixRow<T> operator[](int i){
+    return matrixRow<T>{matData.data() + (size_t)i*ld,extent};}
 
-  /// multiply a matrix by a vector, return same vector type
-  /// \param vec vector to multiply
-  /// \return resulting product vector
-  template <class vT>
-  vT operator *(const vT vec)
+  /// extracts a read-only view of the row at a particular row
+  /// \param i row to extract
+  matrixRow<const T> operator[](int i) const{
+    return matrixRow<const T>{matData.data() + (size_t)i*ld,extent};}
+
+  /// multiply the matrix by the vector stored at in, writing the product to
+  /// out. Both are caller-owned buffers; no storage is allocated. in and out
+  /// must not overlap.
+  /// \param in pointer to the first input entry
+  /// \param out pointer to the first output entry
+  /// \param inStride distance between successive input entries
+  /// \param outStride distance between successive output entries
+  void apply(const T* in, T* out, int inStride=1, int outStride=1) const
   {
-    vT retVec = vec;
     for(int i=0;i<extent;i++)
       {
-	retVec[i]=0;
+	const T* row = matData.data() + (size_t)i*ld;
+	T sum=0;
 	for(int j=0;j<extent;j++)
-	    retVec[i]+=matData[i][j]*vec[j];
+	  sum+=row[j]*in[(size_t)j*inStride];
+	out[(size_t)i*outStride]=sum;
       }
-    return retVec;
   }
 
-  /// multiply two matrices together
-  /// \param mat matrix to multiply (right-left as expected)
-  /// \return the product matrix
-  matrix<T> operator *(matrix<T> mat)
+  /// multiply the matrix by the vector stored at in and accumulate into out,
+  /// as out = alpha*M*in + beta*out. No storage is allocated; in and out must
+  /// not overlap. With beta == 0 the previous contents of out are ignored.
+  /// \param alpha scaling of the product
+  /// \param in pointer to the first input entry
+  /// \param beta scaling of the existing output
+  /// \param out pointer to the first output entry
+  /// \param inStride distance between successive input entries
+  /// \param outStride distance between successive output entries
+  void apply_add(T alpha, const T* in, T beta, T* out, int inStride=1, int outStride=1) const
   {
-    matrix<T> retMat = mat;
     for(int i=0;i<extent;i++)
       {
+	const T* row = matData.data() + (size_t)i*ld;
+	T sum=0;
 	for(int j=0;j<extent;j++)
-	  {
-	    retMat[i][j]=0;
-	    for(int k=0;k<extent;k++)
-	      retMat[i][j]+=matData[i][k]*mat[k][j];
-	  }
+	  sum+=row[j]*in[(size_t)j*inStride];
+	T &o = out[(size_t)i*outStride];
+	o = (beta == T(0)) ? alpha*sum : alpha*sum + beta*o;
       }
+  }
+
+  /// multiply a matrix by a vector, return same vector type
+  /// \param vec vector to multiply
+  /// \return resulting product vector
+  template <class vT>
+  vT operator *(const vT &vec) const
+  {
+    vT retVec(vec.size());
+    apply(&vec[0],&retVec[0]);
+    return retVec;
+  }
+
+  /// multiply two matrices together, using the blocked kernel in
+  /// matrixKernels::gemm
+  /// \param mat matrix to multiply (right-left as expected)
+  /// \return the product matrix
+  matrix<T> operator *(const matrix<T> &mat) const
+  {
+    matrix<T> retMat(extent);
+    matrixKernels::gemm(extent,extent,extent,T(1),data(),ld,mat.data(),mat.ld,T(0),retMat.data(),retMat.ld);
     return retMat;
   }
 
   /// add two matrices together
   /// \param mat summand
   /// \return sum
-  matrix<T> operator +(const matrix<T> mat)
+  matrix<T> operator +(const matrix<T> &mat)
   {
-    matrix<T> retMat = mat;
+    matrix<T> retMat(extent);
     for(int i=0;i<extent;i++)
 	for(int j=0;j<extent;j++)
-	    retMat[i][j]= matData[i][j]+mat[i][j];
+	    retMat[i][j]= (*this)[i][j]+mat[i][j];
     return retMat;
   }
 
   /// subtract two matrices
   /// \param mat differand
   /// \return difference
-  matrix<T> operator -(const matrix<T> mat)
+  matrix<T> operator -(const matrix<T> &mat)
   {
-    matrix<T> retMat = mat;
+    matrix<T> retMat(extent);
     for(int i=0;i<extent;i++)
 	for(int j=0;j<extent;j++)
-	    retMat[i][j]= matData[i][j]-mat[i][j];
+	    retMat[i][j]= (*this)[i][j]-mat[i][j];
     return retMat;
   }
 
 };
 
+
+/// Derivative-type operator stored through its even-odd decomposition
+
+/// Collocation derivative matrices on node sets symmetric about 0 are
+/// centro-antisymmetric, \f$D_{n-1-i,n-1-j} = -D_{i j}\f$, so they map the even
+/// part of a vector to odd and vice versa. Writing \f$s_j = u_j + u_{n-1-j}\f$
+/// and \f$d_j = u_j - u_{n-1-j}\f$, the product is recovered from two half-size
+/// blocks, \f$a = E s\f$ and \f$b = O d\f$, as \f$(Du)_i = a_i + b_i\f$ and
+/// \f$(Du)_{n-1-i} = b_i - a_i\f$. This halves both the stored entries and the
+/// multiplications of a dense apply. For odd n the middle node contributes an
+/// extra column to E and an extra row to O.
+template <class T>
+class evenOddMatrix
+{
+public:
+  int extent; ///< size of the full square operator
+  int half; ///< number of node pairs, extent/2
+  int ld; ///< padded row length of the blocks
+  alignedVector<T> even; ///< the block E, half rows (plus the middle column for odd extent)
+  alignedVector<T> odd; ///< the block O, half rows (plus the middle row for odd extent)
+  bool valid; ///< whether the source operator was centro-antisymmetric to within the tolerance
+  const matrix<T>* dense; ///< the source operator, used for validation; must outlive this object
+  bool validate; ///< when set, every apply is compared against the dense product
+  mutable T maxDeviation; ///< largest deviation from the dense product seen while validating
+
+  /// decomposes a centro-antisymmetric operator into its even and odd blocks
+  /// \param mat the full operator
+  /// \param tol relative tolerance on the centro-antisymmetry check
+  evenOddMatrix(const matrix<T> &mat, T tol = 1e-10)
+    : extent(mat.extent), half(mat.extent/2), ld(matrix<T>::paddedExtent(mat.extent/2 + 1)),
+      even((size_t)(mat.extent/2)*ld), odd((size_t)(mat.extent/2 + 1)*ld),
+      valid(true), dense(&mat), validate(false), maxDeviation(0)
+  {
+    const int n = extent;
+    T scale = 0;
+    for(int i=0;i<n;i++)
+      for(int j=0;j<n;j++)
+	scale = std::max(scale,(T)fabs(mat[i][j]));
+    for(int i=0;i<n;i++)
+      for(int j=0;j<n;j++)
+	if(fabs(mat[n-1-i][n-1-j] + mat[i][j]) > tol*scale)
+	  valid = false;
+    for(int i=0;i<half;i++)
+      {
+	for(int j=0;j<half;j++)
+	  {
+	    even[(size_t)i*ld + j] = (mat[i][j] + mat[i][n-1-j])/2;
+	    odd[(size_t)i*ld + j] = (mat[i][j] - mat[i][n-1-j])/2;
+	  }
+	if(n%2 != 0)
+	  even[(size_t)i*ld + half] = mat[i][half];
+      }
+    if(n%2 != 0)
+      for(int j=0;j<half;j++)
+	odd[(size_t)half*ld + j] = mat[half][j];
+  }
+
+  /// multiply the operator by the vector stored at in, writing the product to
+  /// out. in and out must not overlap.
+  /// \param in pointer to the first input entry
+  /// \param out pointer to the first output entry
+  /// \param inStride distance between successive input entries
+  /// \param outStride distance between successive output entries
+  void apply(const T* in, T* out, int inStride=1, int outStride=1) const
+  {
+    const int n = extent;
+    const bool hasMiddle = (n%2 != 0);
+    for(int i=0;i<half;i++)
+      {
+	const T* e = even.data() + (size_t)i*ld;
+	const T* o = odd.data() + (size_t)i*ld;
+	T a=0;
+	T b=0;
+	for(int j=0;j<half;j++)
+	  {
+	    const T lo = in[(size_t)j*inStride];
+	    const T hi = in[(size_t)(n-1-j)*inStride];
+	    a+=e[j]*(lo + hi);
+	    b+=o[j]*(lo - hi);
+	  }
+	if(hasMiddle)
+	  a+=e[half]*in[(size_t)half*inStride];
+	out[(size_t)i*outStride] = a + b;
+	out[(size_t)(n-1-i)*outStride] = b - a;
+      }
+    if(hasMiddle)
+      {
+	const T* o = odd.data() + (size_t)half*ld;
+	T b=0;
+	for(int j=0;j<half;j++)
+	  b+=o[j]*(in[(size_t)j*inStride] - in[(size_t)(n-1-j)*inStride]);
+	out[(size_t)half*outStride] = b;
+      }
+    if(validate)
+      checkAgainstDense(in,out,inStride,outStride);
+  }
+
+  /// compares a product against the dense operator, entry by entry without
+  /// temporary storage, and records the largest deviation
+  /// \param in pointer to the first input entry
+  /// \param out pointer to the first entry of the product to check
+  /// \param inStride distance between successive input entries
+  /// \param outStride distance between successive output entries
+  /// \return the largest deviation in this product
+  T checkAgainstDense(const T* in, const T* out, int inStride=1, int outStride=1) const
+  {
+    T dev = 0;
+    for(int i=0;i<extent;i++)
+      {
+	T sum=0;
+	for(int j=0;j<extent;j++)
+	  sum+=(*dense)[i][j]*in[(size_t)j*inStride];
+	dev = std::max(dev,(T)fabs(sum - out[(size_t)i*outStride]));
+      }
+    maxDeviation = std::max(maxDeviation,dev);
+    return dev;
+  }
+};
+
 #endif
@@ -1,9 +1,16 @@
 #include <vector>
+#include <array>
 #include <boost/math/tools/roots.hpp>
 #include <boost/numeric/odeint.hpp>
 #include "scalarFunction.hpp"
+#include "spectralBasis.hpp"
+#include "fixedOrderKernels.hpp"
+#include "taskGraph.hpp"
 #include <stdio.h>
 
+#ifndef MULTIDOMAINWAVE_H
+#define MULTIDOMAINWAVE_H
+
 /// A structure for holding a function state history, which just hold a vector
 /// of scalarFunction representing the time series for a single function on a
 /// single domain.
@@ -11,6 +18,29 @@ struct functionStateHistory
 {
   std::vector<scalarFunction> timeStates; ///< the time series data for a single function 
   functionStateHistory(){}
+
+  /// Computes the spectral coefficients of every stored timestep at once: the
+  /// collocation data is gathered into a contiguous timesteps x n block and
+  /// transformed with a single blocked matrix product against the basis'
+  /// cached transform, rather than one quadSum() per snapshot. Each
+  /// snapshot's spectralData is then populated, so later evaluations do not
+  /// transform again.
+  /// \param threads number of threads to split the product over
+  void computeSpectralData(int threads = 1)
+  {
+    if(timeStates.empty())
+      return;
+    std::shared_ptr<spectralBasis> basis = timeStates[0].basis;
+    const int n = basis->n;
+    const int steps = timeStates.size();
+    std::vector<double> nodal((size_t)steps*n),modal((size_t)steps*n);
+    for(int t=0;t<steps;t++)
+      std::copy(timeStates[t].collocationData.begin(),timeStates[t].collocationData.end(),nodal.begin() + (size_t)t*n);
+    basis->toModal(nodal.data(),n,modal.data(),n,steps,threads);
+    for(int t=0;t<steps;t++)
+      timeStates[t].spectralData = std::shared_ptr<std::vector<double>>
+	(new std::vector<double>(modal.begin() + (size_t)t*n,modal.begin() + (size_t)(t + 1)*n));
+  }
 };
 
 /// A structure for holding the history of a single domain, which just holds a
@@ -65,7 +95,7 @@ struct multiStateHistory
 	for(int f=0;f<funcs;f++)
 	  {
 	    scalarFunction newVal = elementStates[d].functionStates[f].timeStates.back();
-	    newVal.collocationData = std::vector<double>(x.begin()+elstart+f*n[d],x.begin()+elstart+(f+1)*n[d]);
+	    newVal.setCollocationData(std::vector<double>(x.begin()+elstart+f*n[d],x.begin()+elstart+(f+1)*n[d]));
 	    elementStates[d].functionStates[f].timeStates.push_back(newVal);
 	  }
 	elstart+=2*n[d];
@@ -75,16 +105,97 @@ struct multiStateHistory
 };
 
 
+/// Strategy used to apply the per-domain derivative operators in the bulk step
+enum derivativeEngine
+{
+  automaticDerivatives, ///< batch runs of equal-order domains when that is expected to pay off
+  denseDerivatives, ///< one fused pass of the operator over both fields per domain
+  batchedDerivatives, ///< one matrix-matrix product over both fields of a run of equal-order domains
+  evenOddDerivatives, ///< one half-size even-odd product per domain and field
+  fixedDerivatives, ///< one fused pass per domain using the compile-time order kernels where available
+  fftDerivatives ///< one FFT differentiation of both fields per domain on a Chebyshev basis, one fused dense pass per domain elsewhere
+};
+
+// lowest orders at which the automatic engine differentiates Chebyshev domains
+// with FFTs rather than dense products, and rather than one matrix product over
+// a batchable run of domains. Only orders whose transform length 2(n-1) is a
+// power of two qualify; other lengths go through Bluestein's algorithm and lose
+// to the products (measured with run_bench --rhs --type coll --basis cheb)
+#ifndef FFT_DERIVATIVE_ORDER
+#define FFT_DERIVATIVE_ORDER 64
+#endif
+#ifndef FFT_BATCHED_DERIVATIVE_ORDER
+#define FFT_BATCHED_DERIVATIVE_ORDER 512
+#endif
+
+
 /// Parent class for the various wave function implementations
 class multiDomainWave{
 public:
+  /// A run of neighbouring domains with equal order that share a single
+  /// derivative operator. Their pi blocks (and likewise their psi blocks) sit
+  /// at a fixed stride of 2*order in the flattened state, so together they form
+  /// a row-major panel the operator can be applied to in one product.
+  struct domainGroup
+  {
+    int first; ///< index of the first domain of the run
+    int count; ///< number of domains in the run
+    int elstart; ///< index in the flattened data of the start of the first domain
+    int order; ///< number of collocation points per function in each domain
+    const matrix<double>* op; ///< the operator shared by the run
+    std::shared_ptr<matrix<double>> opT; ///< transpose of op, the right factor of the batched product
+    std::shared_ptr<evenOddMatrix<double>> opEO; ///< even-odd decomposition of op
+  };
+
+  /// A contiguous piece of a run of domains, the unit of work of the
+  /// per-domain phases of the right-hand side
+  struct domainBlock
+  {
+    int group; ///< index of the run the block belongs to
+    int first; ///< index of the first domain of the block
+    int count; ///< number of domains in the block
+    int elstart; ///< index in the flattened data of the start of the first domain
+  };
+
   std::vector<int> n;///< spectral order of the evolution
   int doms; ///< number of domains
   std::vector<std::shared_ptr<std::vector<double>>> abscissas; ///< a vector of abscissas storage, one for each domain
   std::vector<std::shared_ptr<std::vector<double>>> weights; ///< a vector of weight storage, one for each domain
   std::vector<std::shared_ptr<matrix<double>>> DMats; ///< a vector of derivative matrix storage, one for each domain
+  std::vector<std::shared_ptr<spectralBasis>> bases; ///< the basis of each domain, one instance shared by domains of equal order
   std::function<double(double)> boundData; ///< a function for the left boundary data
   bool verbose;///< a flag for outputting status checkpoints to stdout
+  std::vector<const matrix<double>*> derivOps; ///< the operator applied to the fields of each domain in the bulk step
+  std::vector<domainGroup> groups; ///< the runs of domains sharing an operator, covering all domains in order
+  std::vector<const fixedOrder::kernels*> fixedKernels; ///< compile-time order kernels for each domain, null where not instantiated
+  derivativeEngine engine = automaticDerivatives; ///< how the bulk derivative operators are applied
+  alignedVector<double> workspace; ///< scratch space of the right-hand side, sized at construction so that evaluating it never allocates
+  std::vector<const double*> liftRight; ///< right DG lift vector of each domain, the interpolant to +1 over the weights, null without one
+  std::vector<const double*> liftLeft; ///< left DG lift vector of each domain, the interpolant to -1 over the weights, null without one
+  std::vector<std::shared_ptr<const chebyshevTools::transform>> fftDerivs; ///< FFT differentiation of each domain whose bulk operator is its Chebyshev derivative matrix, else null
+  std::vector<domainBlock> blocks; ///< the blocks the per-domain phases are split into, covering all domains in order
+  std::vector<int> blockBounds; ///< the range of blocks of each thread, balanced by the blocks' n^2 cost
+  std::shared_ptr<threadPool> pool; ///< the threads evaluating blocks in parallel, null to run serially
+  std::shared_ptr<taskGraph> graph; ///< the two phases of every block as a dependency graph, used on a pool
+  std::shared_ptr<taskGraph> stagedGraph; ///< graph with a third phase per block applying the Runge-Kutta stage
+  bool useTaskGraph = true; ///< on a pool, run the phases as a task graph rather than separated by a barrier
+  int reach = 0; ///< how many domains past its own the second phase of a domain reads first-phase results from, besides the one before it
+  int writeReach = 0; ///< how many domains before its own the second phase of a domain writes derivatives into
+
+  /// A low-storage Runge-Kutta stage folded into the right-hand side: as soon
+  /// as a block's derivatives k are final, du = a du + dt k and u += b du are
+  /// applied over its domains, while k is still in cache. u is the state being
+  /// differentiated, which no later task of the evaluation reads.
+  struct rkStage
+  {
+    double* u = nullptr; ///< the state, null when no stage is applied
+    double* du = nullptr; ///< the stage accumulator
+    const double* k = nullptr; ///< the derivatives written by the right-hand side
+    double a = 0; ///< weight of the previous accumulator
+    double b = 0; ///< weight of the accumulator in the state update
+    double dt = 0; ///< the time step
+  };
+  rkStage stage; ///< the stage applied by the next evaluation, if any
 
   /// The generic wave constructor, takes in much data about wave options
   /// \param ord Legendre order of simulation
@@ -94,14 +205,409 @@ public:
   /// \param domains number of domains
   /// \param in_boundData a function representing information about the driving boundary
   /// \param in_verbose whether the function should output status checkpounts
+  /// \param family family of the collocation points in the data
   multiDomainWave(std::vector<int> ord, std::vector<std::shared_ptr<std::vector<double>>> in_abscissas,
 		  std::vector<std::shared_ptr<std::vector<double>>> in_weights,
 		  std::vector<std::shared_ptr<matrix<double>>> in_DMats,
-		  int domains, std::function<double(double)> in_boundData, bool in_verbose)
-    : n(ord), abscissas(in_abscissas),weights(in_weights),DMats(in_DMats), verbose(in_verbose), boundData(in_boundData), doms(domains) {}
+		  int domains, std::function<double(double)> in_boundData, bool in_verbose, nodeFamily family)
+    : multiDomainWave(wrapBases(ord,in_abscissas,in_weights,in_DMats,domains,family),in_boundData,in_verbose) {}
+
+  /// The generic wave constructor on shared bases, one for each domain
+  /// \param in_bases the basis of each domain, usually from spectralBasis::get
+  /// \param in_boundData a function representing information about the driving boundary
+  /// \param in_verbose whether the function should output status checkpounts
+  multiDomainWave(std::vector<std::shared_ptr<spectralBasis>> in_bases, std::function<double(double)> in_boundData,
+		  bool in_verbose)
+    : doms(in_bases.size()), bases(in_bases), boundData(in_boundData), verbose(in_verbose)
+  {
+    for(int d=0;d<doms;d++)
+      {
+	n.push_back(bases[d]->n);
+	abscissas.push_back(bases[d]->abscissas);
+	weights.push_back(bases[d]->weights);
+	DMats.push_back(bases[d]->DMat);
+      }
+    fftDerivs.resize(doms);
+    liftRight.resize(doms);
+    liftLeft.resize(doms);
+  }
+
+  /// wraps separately generated per-domain data into bases, sharing one basis
+  /// between all domains that were handed the same data
+  /// \param ord Legendre order of each domain
+  /// \param in_abscissas vector of abscissa data, one for each domain
+  /// \param in_weights vector of weight data, one for each domain
+  /// \param in_DMats vector of derivative matrix data, one for each domain
+  /// \param domains number of domains, at most the length of each vector
+  /// \param family family of the collocation points in the data
+  /// \return the basis of each of the first domains entries
+  static std::vector<std::shared_ptr<spectralBasis>> wrapBases(std::vector<int> ord,
+							       std::vector<std::shared_ptr<std::vector<double>>> in_abscissas,
+							       std::vector<std::shared_ptr<std::vector<double>>> in_weights,
+							       std::vector<std::shared_ptr<matrix<double>>> in_DMats, int domains,
+							       nodeFamily family)
+  {
+    const size_t available = std::min(std::min(ord.size(),in_abscissas.size()),std::min(in_weights.size(),in_DMats.size()));
+    if(domains < 0 || (size_t)domains > available)
+      {
+	printf("data for %zu domains given for %d domains; using %zu\n",available,domains,available);
+	domains = available;
+      }
+    std::vector<std::shared_ptr<spectralBasis>> wrapped;
+    for(int d=0;d<domains;d++)
+      wrapped.push_back(spectralBasis::wrap(ord[d],family,in_abscissas[d],in_weights[d],in_DMats[d]));
+    return wrapped;
+  }
 
   /// virtual evolution operator - to be overwritten in all inherited classes
   virtual void operator () (const std::vector<double> &x, std::vector<double> &dxdt, const double t){}
+
+  /// Sets the operators applied in the bulk step and partitions the domains
+  /// into runs that share one. Operators are shared if they are the same
+  /// object, or if they have the same order and identical entries.
+  /// \param ops the operator for each domain
+  void setDerivativeOperators(std::vector<const matrix<double>*> ops)
+  {
+    derivOps = ops;
+    groups.clear();
+    fixedKernels.clear();
+    for(int d=0;d<doms;d++)
+      fixedKernels.push_back(fixedOrder::lookup(n[d]));
+    int elstart=0;
+    for(int d=0;d<doms;d++)
+      {
+	if(!groups.empty() && groups.back().order == n[d] && sameOperator(*groups.back().op,*ops[d]))
+	  groups.back().count++;
+	else
+	  groups.push_back(domainGroup{d,1,elstart,n[d],ops[d],nullptr,nullptr});
+	elstart+=2*n[d];
+      }
+    for(domainGroup &g : groups)
+      {
+	g.opEO = std::shared_ptr<evenOddMatrix<double>>(new evenOddMatrix<double>(*g.op));
+	if(g.count < 2)
+	  continue;
+	g.opT = std::shared_ptr<matrix<double>>(new matrix<double>(g.order));
+	for(int i=0;i<g.order;i++)
+	  for(int j=0;j<g.order;j++)
+	    (*g.opT)[i][j] = (*g.op)[j][i];
+      }
+    buildBlocks();
+  }
+
+  /// Evaluates the per-domain phases of the right-hand side on a pool of
+  /// threads. The even-odd validation bookkeeping is not thread safe, so
+  /// validate with a single thread.
+  /// \param threads total number of threads, 1 to run serially
+  void setThreads(int threads)
+  {
+    // size every thread's matrix packing and FFT scratch now, so that
+    // evaluating the right-hand side on the pool never allocates
+    auto reserve = [this](){
+      matrixKernels::reservePacking();
+      for(int d=0;d<doms;d++)
+	if(fftDerivs[d])
+	  {
+	    std::vector<double> zero(2*n[d],0.0),out(2*n[d]);
+	    fftDerivs[d]->derivative(zero.data(),zero.data() + n[d],out.data(),out.data() + n[d]);
+	  }
+    };
+    pool = (threads > 1) ? std::make_shared<threadPool>(threads,reserve) : nullptr;
+    buildBlocks();
+  }
+
+  /// Splits the runs of domains into blocks and the blocks between the
+  /// threads. Run serially each run is one block; on a pool, runs are cut into
+  /// blocks of at most a quarter of a thread's share of the total n^2 cost, so
+  /// that heterogeneous orders balance and work stealing can even out the rest.
+  void buildBlocks()
+  {
+    blocks.clear();
+    double total = 0;
+    for(int d=0;d<doms;d++)
+      total+=(double)n[d]*n[d];
+    const double piece = pool ? total/(4*pool->threads()) : total;
+    std::vector<double> costs;
+    for(int gi=0;gi<(int)groups.size();gi++)
+      {
+	const domainGroup &g = groups[gi];
+	const int per = std::max(1,(int)(piece/((double)g.order*g.order)));
+	for(int first=0;first<g.count;first+=per)
+	  {
+	    const int count = std::min(per,g.count - first);
+	    blocks.push_back(domainBlock{gi,g.first + first,count,g.elstart + 2*g.order*first});
+	    costs.push_back((double)count*g.order*g.order);
+	  }
+      }
+    blockBounds = pool ? pool->partition(costs) : std::vector<int>({0,(int)blocks.size()});
+    graph = buildGraph(false);
+    stagedGraph = buildGraph(true);
+  }
+
+  /// Builds the dependency graph of the phases of every block: task b is the
+  /// first phase of block b, task B + b its second phase, which waits for the
+  /// first phase of every block it reads from, and with a stage task 2B + b
+  /// applies the stage once every block writing into block b is done
+  /// \param staged whether to add the stage phase
+  /// \return the graph
+  std::shared_ptr<taskGraph> buildGraph(bool staged) const
+  {
+    const int B = blocks.size();
+    std::shared_ptr<taskGraph> g = std::make_shared<taskGraph>();
+    for(int b=0;b<B;b++)
+      g->add(0);
+    for(int b=0;b<B;b++)
+      {
+	g->add(1);
+	for(int o=std::max(b - 1,0);o<=std::min(b + reach,B - 1);o++)
+	  g->depend(B + b,o);
+      }
+    for(int b=0;staged && b<B;b++)
+      {
+	g->add(2);
+	for(int o=b;o<=std::min(b + writeReach,B - 1);o++)
+	  g->depend(2*B + b,B + o);
+      }
+    return g;
+  }
+
+  /// Runs body on every block, in parallel when there is a pool, returning
+  /// once all are done
+  /// \param body callable taking a const domainBlock&
+  template <typename F>
+  void forEachBlock(F &&body) const
+  {
+    if(!pool)
+      {
+	for(const domainBlock &b : blocks)
+	  body(b);
+	return;
+      }
+    auto task = [&](int i){ body(blocks[i]);};
+    pool->run(blockBounds,task);
+  }
+
+  /// Runs the two per-domain phases of the right-hand side over every
+  /// block, followed by the Runge-Kutta stage if one is set. The second phase
+  /// of a domain reads the first-phase results of itself, the domain before
+  /// it, and reach domains after it. On a pool with useTaskGraph each task
+  /// starts as soon as the tasks of its neighbours it depends on are done;
+  /// with useTaskGraph off every block finishes a phase before any starts the
+  /// next. Serially the blocks are swept as a wavefront, each phase trailing
+  /// the one before it by just the blocks it depends on, so that a block's
+  /// data is still in cache for its later phases. A traced run always uses
+  /// the task graph, on the calling thread if there is no pool.
+  /// \param first callable taking a const domainBlock&, the first phase
+  /// \param second callable taking a const domainBlock&, the second phase
+  /// \param trace if set, receives the timing of each task of a task graph run
+  template <typename F, typename G>
+  void runPhases(F &&first, G &&second, std::vector<taskGraph::record>* trace = nullptr)
+  {
+    const int B = blocks.size();
+    const bool staged = (stage.u != nullptr);
+    auto third = [&](const domainBlock &b){ applyStage(b);};
+    if((pool && useTaskGraph) || trace)
+      {
+	auto task = [&](int t){
+	  if(t < B)
+	    first(blocks[t]);
+	  else if(t < 2*B)
+	    second(blocks[t - B]);
+	  else
+	    third(blocks[t - 2*B]);
+	};
+	(staged ? stagedGraph : graph)->run(pool.get(),task,trace);
+	return;
+      }
+    if(pool)
+      {
+	forEachBlock(first);
+	forEachBlock(second);
+	if(staged)
+	  forEachBlock(third);
+	return;
+      }
+    for(int b=0;b<B + reach + writeReach;b++)
+      {
+	if(b < B)
+	  first(blocks[b]);
+	if(b - reach >= 0 && b - reach < B)
+	  second(blocks[b - reach]);
+	if(staged && b - reach - writeReach >= 0)
+	  third(blocks[b - reach - writeReach]);
+      }
+  }
+
+  /// Applies the Runge-Kutta stage over the domains of a block
+  /// \param b the block
+  void applyStage(const domainBlock &b) const
+  {
+    const size_t lo = b.elstart, hi = b.elstart + 2*(size_t)b.count*groups[b.group].order;
+    double* __restrict u = stage.u;
+    double* __restrict du = stage.du;
+    const double* __restrict k = stage.k;
+    const double a = stage.a, w = stage.b, dt = stage.dt;
+    for(size_t i=lo;i<hi;i++)
+      {
+	du[i] = a*du[i] + dt*k[i];
+	u[i]+=w*du[i];
+      }
+  }
+
+  /// Applies each domain's bulk operator to its fields, writing the
+  /// derivative of psi into the pi slot of dxdt and the derivative of pi into
+  /// the psi slot, as both wave systems require, and optionally adding the DG
+  /// lift of the flux jumps at the domain boundaries. Each domain's operator is
+  /// applied to both fields in one pass over it, with the lift folded into the
+  /// same loop. Runs of equal-order domains are treated as a (2 count x order)
+  /// panel of pi and psi blocks, multiplied by the transposed operator in a
+  /// single matrix product, after which each domain's two result blocks are
+  /// swapped into place. The blocks of domains are evaluated in parallel when
+  /// there is a pool, and all are done on return.
+  /// \param x the full flattened collocation points
+  /// \param dxdt the full flattened output, every entry is overwritten
+  /// \param jumps the flux jumps of each domain, four per domain ordered (right
+  /// and left for the pi slot, right and left for the psi slot), or null for
+  /// no lift
+  void applyDerivatives(const double* x, double* dxdt, const double* jumps = nullptr) const
+  {
+    forEachBlock([&](const domainBlock &b){ applyDerivatives(b,x,dxdt,jumps);});
+  }
+
+  /// Applies the bulk operators of one block of domains
+  /// \param b the block
+  /// \param x the full flattened collocation points
+  /// \param dxdt the full flattened output
+  /// \param jumps the flux jumps of each domain, or null for no lift
+  /// \sa applyDerivatives
+  void applyDerivatives(const domainBlock &b, const double* x, double* dxdt, const double* jumps) const
+  {
+    const domainGroup &g = groups[b.group];
+    int elstart = b.elstart;
+    if(fftGroup(g))
+      {
+	for(int d=b.first;d<b.first+b.count;d++)
+	  {
+	    fftDerivs[d]->derivative(x + elstart + n[d],x + elstart,dxdt + elstart,dxdt + elstart + n[d]);
+	    addLift(d,elstart,jumps,dxdt);
+	    elstart+=2*n[d];
+	  }
+	return;
+      }
+    if(batchGroup(g))
+      {
+	matrixKernels::gemm(2*b.count,g.order,g.order,1.0,x + b.elstart,g.order,
+			    g.opT->data(),g.opT->ld,0.0,dxdt + b.elstart,g.order);
+	for(int d=b.first;d<b.first+b.count;d++)
+	  {
+	    std::swap_ranges(dxdt + elstart,dxdt + elstart + n[d],dxdt + elstart + n[d]);
+	    addLift(d,elstart,jumps,dxdt);
+	    elstart+=2*n[d];
+	  }
+	return;
+      }
+    const bool evenOdd = (engine == evenOddDerivatives && g.opEO->valid);
+    const fixedOrder::kernels* fixed = useFixedKernels() ? fixedKernels[g.first] : nullptr;
+    const fixedOrder::pairKernel pair = fixed ? fixed->applyPair : &fixedOrder::applyPair<0>;
+    for(int d=b.first;d<b.first+b.count;d++)
+      {
+	if(evenOdd)
+	  {
+	    g.opEO->apply(x + elstart + n[d],dxdt + elstart);
+	    g.opEO->apply(x + elstart,dxdt + elstart + n[d]);
+	    addLift(d,elstart,jumps,dxdt);
+	  }
+	else
+	  pair(g.op->data(),g.op->ld,x + elstart + n[d],x + elstart,dxdt + elstart,dxdt + elstart + n[d],
+	       jumps ? jumps + 4*d : nullptr,liftRight[d],liftLeft[d],n[d]);
+	elstart+=2*n[d];
+      }
+  }
+
+  /// adds the DG lift of a domain's flux jumps to its derivatives, for the
+  /// engines that cannot fold it into the operator product
+  /// \param d the domain
+  /// \param elstart index in the flattened data of the start of the domain
+  /// \param jumps the flux jumps of every domain, or null for no lift
+  /// \param dxdt the full flattened output
+  void addLift(int d, int elstart, const double* jumps, double* dxdt) const
+  {
+    if(!jumps)
+      return;
+    const double* j = jumps + 4*d;
+    for(int i=0;i<n[d];i++)
+      {
+	dxdt[elstart + i]+=j[0]*liftRight[d][i] - j[1]*liftLeft[d][i];
+	dxdt[elstart + n[d] + i]+=j[2]*liftRight[d][i] - j[3]*liftLeft[d][i];
+      }
+  }
+
+  /// turns on or off the comparison of every even-odd product against the
+  /// dense operator
+  /// \param on whether to validate
+  void setValidation(bool on)
+  {
+    for(domainGroup &g : groups)
+      g.opEO->validate = on;
+  }
+
+  /// \return the largest deviation between even-odd and dense products seen
+  /// while validating
+  double validationDeviation() const
+  {
+    double dev = 0;
+    for(const domainGroup &g : groups)
+      dev = std::max(dev,g.opEO->maxDeviation);
+    return dev;
+  }
+
+  /// whether the compile-time order kernels are used where available
+  bool useFixedKernels() const{
+    return engine == automaticDerivatives || engine == fixedDerivatives;}
+
+  /// whether a run of domains is differentiated with FFTs, which needs
+  /// Chebyshev bases. Automatically this is done only for power-of-two
+  /// transform lengths, from FFT_DERIVATIVE_ORDER on for single domains and
+  /// from FFT_BATCHED_DERIVATIVE_ORDER on for runs batchGroup() would batch.
+  /// \param g the run of domains
+  bool fftGroup(const domainGroup &g) const
+  {
+    if(!fftDerivs[g.first])
+      return false;
+    if(engine == fftDerivatives)
+      return true;
+    const int length = 2*(g.order - 1);
+    if(engine != automaticDerivatives || (length & (length - 1)) != 0)
+      return false;
+    return g.order >= (batchGroup(g) ? FFT_BATCHED_DERIVATIVE_ORDER : FFT_DERIVATIVE_ORDER);
+  }
+
+  /// whether a run of domains is applied as one matrix product. Automatically
+  /// this is done once the panel is large enough to amortize packing the
+  /// operator (measured with run_bench --rhs).
+  /// \param g the run of domains
+  bool batchGroup(const domainGroup &g) const
+  {
+    if(g.count < 2 || engine == denseDerivatives || engine == evenOddDerivatives || engine == fixedDerivatives
+       || engine == fftDerivatives)
+      return false;
+    return engine == batchedDerivatives || (g.count*g.order >= 64 && (g.order >= 12 || g.count >= 32));
+  }
+
+  /// compares two operators entry by entry
+  /// \param a first operator
+  /// \param b second operator
+  static bool sameOperator(const matrix<double> &a, const matrix<double> &b)
+  {
+    if(&a == &b)
+      return true;
+    if(a.extent != b.extent)
+      return false;
+    for(int i=0;i<a.extent;i++)
+      if(!std::equal(a[i].begin(),a[i].end(),b[i].begin()))
+	return false;
+    return true;
+  }
 };
 
 
@@ -109,7 +615,7 @@ public:
 
 /// A specialization class from multiDomainWave for the collocation point wave
 /// multiple-domain simulation. This multi-domain method is intended for use
-/// with Gauss-Lobatto abscissas, and evolves by ensuring consistency between
+/// with Legendre or Chebyshev Gauss-Lobatto abscissas, and evolves by ensuring consistency between
 /// the -1 and 1 abscissas at neighboring domains.
 class collTransmittingMultiWave: public multiDomainWave{
 
@@ -125,11 +631,33 @@ public:
   /// \param in_boundData a function representing the first time derivative used for left bound
   /// \param isReflecting true if right bound should reflect, false if transmit
   /// \param in_verbose whether the function should output status checkpounts
+  /// \param family family of the collocation points in the data, which must include the endpoints
   collTransmittingMultiWave(std::vector<int> ord, std::vector<std::shared_ptr<std::vector<double>>> in_abscissas,
 			    std::vector<std::shared_ptr<std::vector<double>>> in_weights,
 			    std::vector<std::shared_ptr<matrix<double>>> in_DMats, int domains,
+			    std::function<double(double)> in_boundData, bool isReflecting, bool in_verbose,
+			    nodeFamily family = gaussLobattoNodes)
+    : collTransmittingMultiWave(wrapBases(ord,in_abscissas,in_weights,in_DMats,domains,family),in_boundData,isReflecting,in_verbose) {}
+
+  /// The collocation wave constructor on shared bases
+  /// \param in_bases the basis of each domain, usually from spectralBasis::get
+  /// \param in_boundData a function representing the first time derivative used for left bound
+  /// \param isReflecting true if right bound should reflect, false if transmit
+  /// \param in_verbose whether the function should output status checkpounts
+  collTransmittingMultiWave(std::vector<std::shared_ptr<spectralBasis>> in_bases,
 			    std::function<double(double)> in_boundData, bool isReflecting, bool in_verbose)
-    : multiDomainWave(ord,in_abscissas,in_weights,in_DMats,domains,in_boundData,in_verbose), reflect(isReflecting) {}
+    : multiDomainWave(in_bases,in_boundData,in_verbose), reflect(isReflecting)
+  {
+    // the interface to the left of a domain writes the right edge of the domain before it
+    writeReach = 1;
+    std::vector<const matrix<double>*> ops;
+    for(int d=0;d<doms;d++)
+      {
+	ops.push_back(DMats[d].get());
+	fftDerivs[d] = bases[d]->chebyshevTransform();
+      }
+    setDerivativeOperators(ops);
+  }
 
   /// Wave evolution operator, for use in boost ode libraries. This gives the
   /// first derivative of each collocation point with respect to time by
@@ -140,74 +668,92 @@ public:
   /// \param dxdt the set of first derivatives with respect to time - populated
   /// by this function as return parameter
   /// \param t simulation time of the timestep considered
-  /// \sa bulkEvolve
+  /// \sa applyDerivatives
   void operator() ( const std::vector<double> &x, std::vector<double> &dxdt, const double t)
+  {
+    evaluate(x,dxdt,t);
+  }
+
+  /// Evaluates the right-hand side, optionally tracing its task graph
+  /// \param x the set of flattened collocation points
+  /// \param dxdt the set of first derivatives with respect to time - populated
+  /// by this function as return parameter
+  /// \param t simulation time of the timestep considered
+  /// \param trace if set, receives the timing of each task of a task graph run
+  void evaluate(const std::vector<double> &x, std::vector<double> &dxdt, const double t,
+		std::vector<taskGraph::record>* trace = nullptr)
   {
     // 2 steps : first evolve the bulk of each domain and get out the presumed time dependence
     //           at each interface, then impose agreement at each interface by averaging.
     //           This is slightly different from the Continuous Galerkin method, but only
     //           in the details of where the weight factors appear.
+    //           Interface i needs only the bulk of domains i-1 and i.
+    const double bound = boundData(t+1.0);
+    runPhases([&](const domainBlock &b){ applyDerivatives(b,x.data(),dxdt.data(),nullptr);},
+	      [&](const domainBlock &b){ averageInterfaces(b,dxdt.data(),bound);},trace);
+    if((int)(t) == t && verbose)
+	printf("simulation time t=%f\n",t);
+  }
 
-    
-    // bulk evolve and get boundary vals
-    std::vector<double> rightderivspi(doms+1);
-    std::vector<double> rightderivspsi(doms+1);
-    std::vector<double> leftderivspi(doms+1);
-    std::vector<double> leftderivspsi(doms+1);
-    //elstart tracks the position in the array of the start of the element, as they are of nonuniform size
-    std::vector<double> derivsCatcher;
-    int elstart = 0;
-    for(int i=0;i<doms;i++)
+  /// Imposes agreement at the interface to the left of each domain of a
+  /// block, and at the right boundary if the block ends there
+  /// \param b the block
+  /// \param dxdt the full flattened derivatives, with the bulk of the block and the domain before it evolved
+  /// \param bound the left boundary data at this time
+  void averageInterfaces(const domainBlock &b, double* dxdt, double bound) const
+  {
+    int elstart = b.elstart;
+    for(int i=b.first;i<b.first+b.count;i++)
       {
-	derivsCatcher = bulkEvolve(x,dxdt,i,elstart);
-	rightderivspi[i]=derivsCatcher[0];
-	rightderivspsi[i]=derivsCatcher[1];
-	leftderivspi[i+1]=derivsCatcher[2];
-	leftderivspsi[i+1]=derivsCatcher[3];
+	averageInterface(i,elstart,dxdt,bound);
 	elstart+=2*n[i];
       }
+    if(b.first + b.count == doms)
+      averageInterface(doms,elstart,dxdt,bound);
+  }
+
+  /// Imposes agreement at one interface by averaging the derivatives from
+  /// either side of it; the outer boundaries take the missing side from the
+  /// boundary conditions
+  /// \param i the interface, between domains i-1 and i
+  /// \param elstart index in the flattened data of the start of domain i
+  /// \param dxdt the full flattened derivatives
+  /// \param bound the left boundary data at this time
+  void averageInterface(int i, int elstart, double* dxdt, double bound) const
+  {
+    double rightpi = 0, rightpsi = 0, leftpi = 0, leftpsi = 0;
+    if(i < doms)
+      {
+	rightpi = dxdt[elstart];
+	rightpsi = dxdt[elstart + n[i]];
+      }
+    if(i > 0)
+      {
+	leftpi = dxdt[elstart - n[i-1] - 1];
+	leftpsi = dxdt[elstart - 1];
+      }
     //leftmost and rightmost parts need to be modified to obey boundary conditions
-    leftderivspi[0] = -rightderivspi[0] + 2*boundData(t+1.0);
-    leftderivspsi[0] = rightderivspi[0];
-    rightderivspi[doms] = - leftderivspi[doms] - (reflect ? 0 : 2*leftderivspsi[doms]);
-    rightderivspsi[doms] = leftderivspsi[doms];
+    if(i == 0)
+      {
+	leftpi = -rightpi + 2*bound;
+	leftpsi = rightpi;
+      }
+    if(i == doms)
+      {
+	rightpi = - leftpi - (reflect ? 0 : 2*leftpsi);
+	rightpsi = leftpsi;
+      }
     //edges evolve via averaging
-    elstart=0;
-    for(int i=0;i<doms;i++)
+    if(i < doms)
       {
-	dxdt[elstart] = (leftderivspi[i] + rightderivspi[i])/2.0;
-	dxdt[elstart + n[i]] = (leftderivspsi[i] + rightderivspsi[i])/2.0;
-	dxdt[elstart + n[i] - 1] = (leftderivspi[i+1] + rightderivspi[i+1])/2.0;
-	dxdt[elstart + 2*n[i] - 1] = (leftderivspsi[i+1] + rightderivspsi[i+1])/2.0;
-	elstart+=2*n[i];
+	dxdt[elstart] = (leftpi + rightpi)/2.0;
+	dxdt[elstart + n[i]] = (leftpsi + rightpsi)/2.0;
       }
-    if((int)(t) == t && verbose)
-	printf("simulation time t=%f\n",t);
-  }
-
-
-  /// Function for evolving the bulk of the individual elements
-  /// \param x the full flattened collocation points (for all domains)
-  /// \param dxdt the full set of collocation first derivative to be populated,
-  /// partially populated (for a single domain) as a return parameter of this
-  /// function
-  /// \param el number of the domain element to be populated
-  /// \param elstart the index in the full flattened data of the start of the
-  /// element to be populated
-  /// \return a vector of the boundary derivatives (left psi, left pi, right
-  /// psi, right pi)
-  std::vector<double> bulkEvolve(const std::vector<double> &x, std::vector<double> &dxdt,int el,int elstart)
-  {
-    std::shared_ptr<std::vector<double>> pi(new std::vector<double>(x.begin()+elstart,x.begin()+elstart+n[el]));
-    std::shared_ptr<std::vector<double>> psi(new std::vector<double>(x.begin()+elstart+n[el],x.begin()+elstart+2*n[el]));
-    std::vector<double> dpsi = ((*DMats[el])*(*psi));
-    std::vector<double> dpi = ((*DMats[el])*(*pi));
-    for(int i=0;i<n[el];i++)
+    if(i > 0)
       {
-	dxdt[elstart + i] = dpsi[i];
-	dxdt[elstart + n[el] + i] = dpi[i];
+	dxdt[elstart - n[i-1] - 1] = (leftpi + rightpi)/2.0;
+	dxdt[elstart - 1] = (leftpsi + rightpsi)/2.0;
       }
-    return std::vector<double>({dpsi[0],dpi[0],dpsi[n[el]-1],dpi[n[el]-1]});
   }
 };
 
@@ -220,11 +766,12 @@ public:
 /// between domains
 class DGTransmittingMultiWave: public multiDomainWave{
 public:
-  std::vector<std::vector<double>> leftInterpolant;///< the interpolant values for the point -1 for each domain
-  std::vector<std::vector<double>> rightInterpolant;///< the interpolant values for the point 1 for each domain
-  std::vector<std::shared_ptr<std::vector<double>>> baryWeights;///< the barycentric weights data for each domain
+  std::vector<std::shared_ptr<std::vector<double>>> leftInterpolant;///< the interpolant values for the point -1 for each domain, shared with its basis
+  std::vector<std::shared_ptr<std::vector<double>>> rightInterpolant;///< the interpolant values for the point 1 for each domain, shared with its basis
+  std::vector<std::shared_ptr<std::vector<double>>> baryWeights;///< the barycentric weights data for each domain, shared with its basis
 
-  std::vector<matrix<double>*> DMatsHat; ///< the adjusted matrix datas for the DG computation
+  std::vector<std::shared_ptr<const matrix<double>>> DMatsHat; ///< the weight-scaled DG operator of each domain, shared between domains on the same basis
+  std::vector<std::shared_ptr<const alignedVector<double>>> lifts; ///< the packed right and left lift vectors of each domain, n each, shared between domains on the same basis
   bool reflect;///< true if right boundary should reflect, false if transmit
 
 
@@ -240,42 +787,64 @@ public:
   /// \param in_boundData a function representing the first time derivative used for left bound
   /// \param isReflecting true if right bound should reflect, false if transmit
   /// \param in_verbose whether the function should output status checkpounts  
+  /// \param family family of the collocation points in the data
   DGTransmittingMultiWave(std::vector<int> ord, std::vector<std::shared_ptr<std::vector<double>>> in_abscissas,
 			  std::vector<std::shared_ptr<std::vector<double>>> in_weights,
 			  std::vector<std::shared_ptr<matrix<double>>> in_DMats, int domains,
+			  std::function<double(double)> in_boundData, bool isReflecting, bool in_verbose,
+			  nodeFamily family = gaussNodes)
+    : DGTransmittingMultiWave(wrapBases(ord,in_abscissas,in_weights,in_DMats,domains,family),in_boundData,isReflecting,in_verbose) {}
+
+  /// The discontinous Galerkin wave constructor on shared bases, which
+  /// already hold the barycentric weights and the interpolants to +/-1.
+  /// \param in_bases the basis of each domain, usually from spectralBasis::get
+  /// \param in_boundData a function representing the first time derivative used for left bound
+  /// \param isReflecting true if right bound should reflect, false if transmit
+  /// \param in_verbose whether the function should output status checkpounts
+  DGTransmittingMultiWave(std::vector<std::shared_ptr<spectralBasis>> in_bases,
 			  std::function<double(double)> in_boundData, bool isReflecting, bool in_verbose)
-    : multiDomainWave(ord,in_abscissas,in_weights,in_DMats,domains,in_boundData,in_verbose),reflect(isReflecting)
+    : multiDomainWave(in_bases,in_boundData,in_verbose),reflect(isReflecting)
   {
-    double lefts;
-    double leftt;
-    double rights;
-    double rightt;
+    // a domain's jumps need the fluxes of the domain after it as well
+    reach = 1;
     for(int d=0;d<doms;d++)
       {
-	leftInterpolant.push_back(std::vector<double>());
-	rightInterpolant.push_back(std::vector<double>());
-	lefts=0;
-	rights=0;
-	baryWeights.push_back(legendreTools::generateBaryWeights(n[d],abscissas[d]));
-	for(int i=0;i<n[d];i++)
+	leftInterpolant.push_back(bases[d]->leftInterpolant);
+	rightInterpolant.push_back(bases[d]->rightInterpolant);
+	baryWeights.push_back(bases[d]->baryWeights);
+	int shared = 0;
+	while(shared < d && bases[shared] != bases[d])
+	  shared++;
+	if(shared < d)
 	  {
-	    leftt=baryWeights[d]->at(i)/(-1.0 - abscissas[d]->at(i));
-	    rightt=baryWeights[d]->at(i)/(1.0 - abscissas[d]->at(i));
-	    leftInterpolant[d].push_back(leftt);
-	    rightInterpolant[d].push_back(rightt);
-	    lefts+=leftt;
-	    rights+=rightt;
+	    DMatsHat.push_back(DMatsHat[shared]);
+	    lifts.push_back(lifts[shared]);
 	  }
-	for(int i=0;i<n[d];i++)
+	else
 	  {
-	    leftInterpolant[d][i]=leftInterpolant[d][i]/lefts;
-	    rightInterpolant[d][i]=rightInterpolant[d][i]/rights;
+	    const std::vector<double> &w = *weights[d];
+	    std::shared_ptr<matrix<double>> hat(new matrix<double>(n[d]));
+	    for(int i=0;i<n[d];i++)
+	      for(int j=0;j<n[d];j++)
+		(*hat)[i][j] = -(*DMats[d])[j][i]*w[j]/w[i];
+	    std::shared_ptr<alignedVector<double>> lift(new alignedVector<double>(2*n[d]));
+	    for(int i=0;i<n[d];i++)
+	      {
+		(*lift)[i] = (*rightInterpolant[d])[i]/w[i];
+		(*lift)[n[d] + i] = (*leftInterpolant[d])[i]/w[i];
+	      }
+	    DMatsHat.push_back(hat);
+	    lifts.push_back(lift);
 	  }
-	DMatsHat.push_back(new matrix<double>(n[d],DMats[d]->matData));
-	for(int i=0;i<n[d];i++)
-	  for(int j=0;j<n[d];j++)
-	    DMatsHat[d]->matData[i][j] = -DMats[d]->matData[j][i] *weights[d]->at(j)/weights[d]->at(i);
+	liftRight[d] = lifts[d]->data();
+	liftLeft[d] = lifts[d]->data() + n[d];
       }
+    std::vector<const matrix<double>*> ops;
+    for(int d=0;d<doms;d++)
+      ops.push_back(DMatsHat[d].get());
+    setDerivativeOperators(ops);
+    // the numerical fluxes at each interface for pi and psi, then the four flux jumps of each domain
+    workspace.assign(4*(doms + 1) + 4*doms,0.0);
   }
 
   /// Wave evolution operator, for use in boost ode libraries. This gives the
@@ -288,66 +857,103 @@ public:
   /// \param t simulation time of the timestep considered
   void operator() ( const std::vector<double> &x, std::vector<double> &dxdt, const double t)
   {
+    evaluate(x,dxdt,t);
+  }
 
-    // 2 steps : first derive the left and right fluxes for each domain and variable, then use them to
-    //           evolve each of the collocation points.
+  /// Evaluates the right-hand side, optionally tracing its task graph
+  /// \param x the set of flattened collocation points
+  /// \param dxdt the set of first derivatives with respect to time - populated
+  /// by this function as return parameter
+  /// \param t simulation time of the timestep considered
+  /// \param trace if set, receives the timing of each task of a task graph run
+  void evaluate(const std::vector<double> &x, std::vector<double> &dxdt, const double t,
+		std::vector<taskGraph::record>* trace = nullptr)
+  {
 
-    std::vector<double> rightfluxpi;
-    std::vector<double> rightfluxpsi;
-    std::vector<double> leftfluxpi;
-    std::vector<double> leftfluxpsi;
+    // 2 steps : first derive the left and right fluxes for each domain and variable, then use them to
+    //           evolve each of the collocation points. A domain's evolution needs only the fluxes
+    //           of itself and its two neighbours.
 
-    std::vector<scalarFunction> pis;
-    std::vector<scalarFunction> psis;
+    workspace[0] = boundData(t+1.0);
+    workspace[doms + 1] = -boundData(t+1.0);
+    runPhases([&](const domainBlock &b){ fluxes(b,x.data());},
+	      [&](const domainBlock &b){ evolveBulk(b,x.data(),dxdt.data());},trace);
+  
+    if((int)(t) == t && verbose)
+      printf("simulation time t=%f\n",t);
+  }
 
-    int elstart=0;
-    //generate the vectors of field values
-    for(int d=0;d<doms;d++)
+  /// Computes the numerical fluxes at the boundaries of each domain of a
+  /// block from its boundary traces, which are dot products of the fields with
+  /// the basis' interpolants to +/-1. Each domain sets only its own fluxes.
+  /// \param b the block
+  /// \param x the full flattened collocation points
+  void fluxes(const domainBlock &b, const double* x)
+  {
+    double* rightfluxpi = workspace.data();
+    double* rightfluxpsi = rightfluxpi + doms + 1;
+    double* leftfluxpi = rightfluxpsi + doms + 1;
+    double* leftfluxpsi = leftfluxpi + doms + 1;
+    int elstart = b.elstart;
+    for(int d=b.first;d<b.first+b.count;d++)
       {
-	pis.push_back(scalarFunction(n[d],abscissas[d],weights[d],DMats[d],
-				     std::vector<double>(x.begin()+ elstart,x.begin()+elstart+n[d])));
-	psis.push_back(scalarFunction(n[d],abscissas[d],weights[d],DMats[d],
-				      std::vector<double>(x.begin()+elstart+n[d],x.begin()+elstart+ 2*n[d])));
+	const double* pi = x + elstart;
+	const double* psi = x + elstart + n[d];
+	const double piLeft = trace(d,leftInterpolant[d]->data(),pi);
+	const double psiLeft = trace(d,leftInterpolant[d]->data(),psi);
+	const double piRight = trace(d,rightInterpolant[d]->data(),pi);
+	const double psiRight = trace(d,rightInterpolant[d]->data(),psi);
+	leftfluxpi[d] = (piLeft + psiLeft)/2.0;
+	rightfluxpi[d+1] = (piRight - psiRight)/2.0;
+	leftfluxpsi[d] = (piLeft + psiLeft)/2.0;
+	rightfluxpsi[d+1] = (-piRight + psiRight)/2.0;
 	elstart+=2*n[d];
       }
-
-    rightfluxpi.push_back(boundData(t+1.0));
-    rightfluxpsi.push_back(-boundData(t+1.0));
-
-    for(int d=0;d<doms;d++)
+    if(b.first + b.count == doms)
       {
-	leftfluxpi.push_back((pis[d].at(-1.0) + psis[d].at(-1.0))/2.0);
-     	rightfluxpi.push_back((pis[d].at(1.0) - psis[d].at(1.0))/2.0);	
-	leftfluxpsi.push_back((pis[d].at(-1.0) + psis[d].at(-1.0))/2.0);
-	rightfluxpsi.push_back((-pis[d].at(1.0) + psis[d].at(1.0))/2.0);
+	leftfluxpi[doms] = reflect ? -rightfluxpi[doms]: 0;
+	leftfluxpsi[doms] = reflect ? -rightfluxpi[doms]: 0;
       }
+  }
 
-    
-    leftfluxpi.push_back(reflect ? -rightfluxpi[doms]: 0);
-    leftfluxpsi.push_back(reflect ? -rightfluxpi[doms]: 0);
-
-    //step 2: evolve the bulk using flux vals
-    std::vector<double> dpsi;
-    std::vector<double> dpi;
-    elstart=0;
-    for(int d=0;d<doms;d++)
+  /// Evolves the bulk of each domain of a block using the flux jumps at its
+  /// boundaries, applying the derivative matrices directly into dxdt with the
+  /// jumps lifted in the same pass
+  /// \param b the block
+  /// \param x the full flattened collocation points
+  /// \param dxdt the full flattened derivatives
+  void evolveBulk(const domainBlock &b, const double* x, double* dxdt)
+  {
+    const double* rightfluxpi = workspace.data();
+    const double* rightfluxpsi = rightfluxpi + doms + 1;
+    const double* leftfluxpi = rightfluxpsi + doms + 1;
+    const double* leftfluxpsi = leftfluxpi + doms + 1;
+    double* jumps = workspace.data() + 4*(doms + 1);
+    for(int d=b.first;d<b.first+b.count;d++)
       {
-	dpsi = ((*DMatsHat[d])*(psis[d].collocationData));
-	dpi = ((*DMatsHat[d])*(pis[d].collocationData));
-	for(int i=0;i<n[d];i++)
-	  {
-
-	    dxdt[elstart + i] = (dpsi[i]
-				 + (leftfluxpi[d+1] - rightfluxpi[d+1])*rightInterpolant[d][i]/weights[d]->at(i)
-				 -(leftfluxpi[d] - rightfluxpi[d])*leftInterpolant[d][i]/weights[d]->at(i));
-	    dxdt[elstart + i + n[d]] = (dpi[i]
-					+ (leftfluxpsi[d+1] - rightfluxpsi[d+1])*rightInterpolant[d][i]/weights[d]->at(i)
-					-(leftfluxpsi[d] - rightfluxpsi[d])*leftInterpolant[d][i]/weights[d]->at(i)); 
-	  }
-	elstart+=2*n[d];
+	jumps[4*d] = leftfluxpi[d+1] - rightfluxpi[d+1];
+	jumps[4*d + 1] = leftfluxpi[d] - rightfluxpi[d];
+	jumps[4*d + 2] = leftfluxpsi[d+1] - rightfluxpsi[d+1];
+	jumps[4*d + 3] = leftfluxpsi[d] - rightfluxpsi[d];
       }
-  
-    if((int)(t) == t && verbose)
-      printf("simulation time t=%f\n",t);
+    applyDerivatives(b,x,dxdt,jumps);
+  }
+
+  /// Evaluates a field of a domain at a boundary as the dot product of its
+  /// collocation values with the boundary interpolant
+  /// \param d the domain
+  /// \param interp the interpolant to the boundary
+  /// \param field pointer to the n[d] collocation values of the field
+  /// \return the value of the field at the boundary
+  double trace(int d, const double* interp, const double* field) const
+  {
+    if(useFixedKernels() && fixedKernels[d])
+      return fixedKernels[d]->dot(interp,field);
+    double sum = 0;
+    for(int i=0;i<n[d];i++)
+      sum+=interp[i]*field[i];
+    return sum;
   }
 };
+
+#endif
@@ -0,0 +1,945 @@
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <thread>
+#include <iostream>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/math/special_functions/legendre.hpp>
+#include "benchWaves.hpp"
+#include "interpolationPlan.hpp"
+#include "waveAlgebra.hpp"
+#include "lowStorageRK.hpp"
+
+/// Times a callable by repeating it until at least minSeconds have elapsed
+/// \param f the work to be timed
+/// \param minSeconds the minimum total time to spend repeating the work
+/// \return the average wall-clock seconds per call
+double timeCall(std::function<void()> f, double minSeconds = 0.2)
+{
+  f();
+  // repeat in doubling batches so the clock is read rarely even for tiny kernels
+  long reps = 1;
+  double elapsed = 0;
+  while(true)
+    {
+      auto start = std::chrono::steady_clock::now();
+      for(long r=0;r<reps;r++)
+	f();
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      if(elapsed >= minSeconds)
+	break;
+      reps*=2;
+    }
+  return elapsed/reps;
+}
+
+/// Keeps a benchmarked result observable, so that the compiler cannot drop
+/// the work computing it as dead code
+/// \param v the result
+inline void keep(double v)
+{
+  static volatile double sink;
+  sink = v;
+}
+
+/// The matrix product as implemented before the blocked kernel: a triple loop
+/// over vector-of-vectors storage, kept here as the benchmark reference
+/// \param a left factor
+/// \param b right factor
+/// \return the product matrix
+std::vector<std::vector<double>> referenceMultiply(const std::vector<std::vector<double>> &a,
+						   const std::vector<std::vector<double>> &b)
+{
+  const int n = a.size();
+  std::vector<std::vector<double>> c(n,std::vector<double>(n));
+  for(int i=0;i<n;i++)
+    for(int j=0;j<n;j++)
+      {
+	c[i][j]=0;
+	for(int k=0;k<n;k++)
+	  c[i][j]+=a[i][k]*b[k][j];
+      }
+  return c;
+}
+
+/// Benchmarks the blocked matrix product against the reference triple loop
+/// for the spectral orders used in practice, reporting GFLOP/s and the largest
+/// deviation between the two results
+void benchGemm()
+{
+  printf("%6s %14s %14s %10s %12s\n","n","reference GF/s","blocked GF/s","speedup","max |diff|");
+  for(int n : {8,12,16,20,32,48,64,96,128,192,256,384,512})
+    {
+      std::vector<std::vector<double>> a(n,std::vector<double>(n));
+      std::vector<std::vector<double>> b(n,std::vector<double>(n));
+      for(int i=0;i<n;i++)
+	for(int j=0;j<n;j++)
+	  {
+	    a[i][j] = sin(0.37*i + 1.3*j);
+	    b[i][j] = cos(0.11*i - 0.7*j);
+	  }
+      matrix<double> A(n,a);
+      matrix<double> B(n,b);
+
+      std::vector<std::vector<double>> refC;
+      matrix<double> C(n);
+      double refTime = timeCall([&](){ refC = referenceMultiply(a,b);});
+      double newTime = timeCall([&](){ C = A*B;});
+      double maxDiff = 0;
+      for(int i=0;i<n;i++)
+	for(int j=0;j<n;j++)
+	  maxDiff = std::max(maxDiff,fabs(C[i][j] - refC[i][j]));
+      double flops = 2.0*n*(double)n*n;
+      printf("%6d %14.3f %14.3f %10.2f %12.3e\n",n,flops/refTime*1e-9,flops/newTime*1e-9,
+	     refTime/newTime,maxDiff);
+    }
+}
+
+/// Benchmarks the compile-time order kernels against the generic runtime-order
+/// loops for every instantiated order, reporting the speedup of each kernel:
+/// the fused products with both fields of a domain against the same kernel
+/// instantiated for any order, and the boundary interpolation against a plain
+/// dot product
+void benchFixed()
+{
+  printf("%6s %12s %12s %12s\n","n","pair ns","pair x","dot x");
+  for(int n=FIXED_ORDER_MIN;n<=FIXED_ORDER_MAX;n++)
+    {
+      const fixedOrder::kernels* k = fixedOrder::lookup(n);
+      matrix<double> D(n);
+      std::vector<double> in(n),in2(n),out(n),out2(n),left(n);
+      for(int i=0;i<n;i++)
+	{
+	  in[i] = sin(0.3*i);
+	  in2[i] = cos(0.4*i);
+	  left[i] = cos(0.2*i);
+	  for(int j=0;j<n;j++)
+	    D[i][j] = cos(0.7*i - 0.3*j);
+	}
+      double genPair = timeCall([&](){
+	  fixedOrder::applyPair<0>(D.data(),D.ld,in.data(),in2.data(),out.data(),out2.data(),nullptr,nullptr,nullptr,n);
+	  keep(out[0]);},0.02);
+      double fixPair = timeCall([&](){
+	  k->applyPair(D.data(),D.ld,in.data(),in2.data(),out.data(),out2.data(),nullptr,nullptr,nullptr,n);
+	  keep(out[0]);},0.02);
+      double genDot = timeCall([&](){
+	  double s=0;
+	  for(int j=0;j<n;j++)
+	    s+=left[j]*in[j];
+	  keep(s);},0.02);
+      double fixDot = timeCall([&](){ keep(k->dot(left.data(),in.data()));},0.02);
+      printf("%6d %12.1f %12.2f %12.2f\n",n,fixPair*1e9,genPair/fixPair,genDot/fixDot);
+    }
+}
+
+/// Benchmarks applying one operator to both fields of a domain in a single
+/// fused pass, with the precomputed DG lift vectors folded in, against two
+/// separate products followed by the lift divided through by the weights, at
+/// orders from in-cache to well past it
+void benchFused()
+{
+  printf("%6s %14s %14s %10s %12s\n","n","separate us","fused us","speedup","max diff");
+  for(int n : {16,32,64,128,256,512})
+    {
+      matrix<double> D(n);
+      std::vector<double> u(n),v(n),du(n),dv(n),fu(n),fv(n),left(n),right(n),w(n),liftL(n),liftR(n);
+      const double jumps[4] = {0.3,0.2,-0.1,0.4};
+      for(int i=0;i<n;i++)
+	{
+	  u[i] = sin(0.3*i);
+	  v[i] = cos(0.1*i);
+	  left[i] = cos(0.2*i);
+	  liftL[i] = left[i]/w[i];
+	  liftR[i] = right[i]/w[i];
+	  for(int j=0;j<n;j++)
+	    D[i][j] = cos(0.7*i - 0.3*j);
+	}
+      const fixedOrder::kernels* k = fixedOrder::lookup(n);
+      const fixedOrder::pairKernel pair = k ? k->applyPair : &fixedOrder::applyPair<0>;
+      double separate = timeCall([&](){
+	  D.apply(u.data(),du.data());
+	  D.apply(v.data(),dv.data());
+	  for(int i=0;i<n;i++)
+	    {
+	      du[i]+=(jumps[0]*right[i] - jumps[1]*left[i])/w[i];
+	      dv[i]+=(jumps[2]*right[i] - jumps[3]*left[i])/w[i];
+	    }
+	  keep(du[0]);},0.05);
+      double fused = timeCall([&](){
+	  pair(D.data(),D.ld,u.data(),v.data(),fu.data(),fv.data(),jumps,liftR.data(),liftL.data(),n);
+	  keep(fu[0]);},0.05);
+      double diff = 0;
+      for(int i=0;i<n;i++)
+	diff = std::max(diff,std::max(fabs(du[i] - fu[i]),fabs(dv[i] - fv[i])));
+      printf("%6d %14.3f %14.3f %10.2f %12.2e\n",n,separate*1e6,fused*1e6,separate/fused,diff);
+    }
+}
+
+/// Reference Gauss or Gauss-Lobatto weights for benchNodes: each node is
+/// refined by Newton-Raphson on the three-term recurrence carried in long
+/// double, and its weight taken there from \f$2/((1 - x^2) P_n^\prime(x)^2)\f$, or
+/// \f$2/(n(n-1) P_{n-1}(x)^2)\f$ for Gauss-Lobatto. O(n^2), for moderate n only.
+/// \param n number of nodes
+/// \param lobatto true for Gauss-Lobatto nodes, false for Gauss-Legendre
+/// \param x the nodes to refine
+/// \return the weights
+std::vector<long double> referenceWeights(int n, bool lobatto, const std::vector<double> &x)
+{
+  const int m = lobatto ? n - 1 : n;
+  // P_m and its first two derivatives
+  auto legendre = [m](long double t, long double &p, long double &dp, long double &ddp){
+    long double p0 = 1, p1 = t;
+    for(int k=2;k<=m;k++)
+      {
+	const long double p2 = ((2*k - 1)*t*p1 - (k - 1)*p0)/k;
+	p0 = p1;
+	p1 = p2;
+      }
+    p = p1;
+    dp = m*(t*p1 - p0)/(t*t - 1);
+    ddp = (2*t*dp - m*(m + 1.0L)*p)/(1 - t*t);
+  };
+  std::vector<long double> w(n);
+  for(int i=0;i<n;i++)
+    {
+      if(lobatto && (i == 0 || i == n - 1))
+	{
+	  w[i] = 2.0L/(n*(n - 1.0L));
+	  continue;
+	}
+      long double t = x[i], p, dp, ddp;
+      for(int it=0;it<3;it++)
+	{
+	  legendre(t,p,dp,ddp);
+	  t-=lobatto ? dp/ddp : p/dp;
+	}
+      legendre(t,p,dp,ddp);
+      w[i] = lobatto ? 2.0L/(m*(m + 1.0L)*p*p) : 2.0L/((1 - t*t)*dp*dp);
+    }
+  return w;
+}
+
+/// Cross-validates the O(n) Glaser-Liu-Rokhlin node generator against the
+/// Newton-Raphson generator for both node families at low and moderate
+/// orders, reporting the largest node and derivative matrix deviations and
+/// the largest weight error against a long double reference, then times it up
+/// to very high orders. At every order it also reports how far the weights
+/// sum from 2 and the largest error integrating x^2 and the Chebyshev
+/// polynomial of the highest even degree the rule integrates exactly.
+void benchNodes()
+{
+  printf("%6s %8s %12s %12s %12s %12s %12s %12s %12s\n","n","family","newton ms","glr ms","max |dx|","max rel dw",
+	 "max rel dD","|sum w - 2|","exactness");
+  for(int n : {2,3,4,5,8,9,16,20,31,32,33,64,100,128,200,256,500,1000,10000,100000})
+    for(int lobatto=0;lobatto<2;lobatto++)
+      {
+	std::pair<std::shared_ptr<std::vector<double>>,std::shared_ptr<std::vector<double>>> glr;
+	double glrTime = timeCall([&](){ glr = legendreTools::generateGLRQuadrature(n,lobatto);},0.05);
+	const std::vector<double> &gx = *glr.first, &gw = *glr.second;
+	// the highest even degree integrated exactly, 2n-1 for Gauss and 2n-3 for Gauss-Lobatto
+	const int degree = 2*((lobatto ? 2*n - 3 : 2*n - 1)/2);
+	long double sum = 0, square = 0, top = 0;
+	for(int i=0;i<n;i++)
+	  {
+	    sum+=gw[i];
+	    square+=gw[i]*(long double)gx[i]*gx[i];
+	    top+=gw[i]*cosl(degree*acosl(gx[i]));
+	  }
+	// T_k integrates to 2/(1 - k^2) for even k, and keeps unit size up to the ends
+	const double exact = (degree < 2) ? 0.0 : std::max(fabs((double)(square - 2.0L/3.0L)),
+							    fabs((double)(top - 2.0L/(1.0L - (long double)degree*degree))));
+	printf("%6d %8s",n,lobatto ? "lobatto" : "gauss");
+	if(n > 1000)
+	  {
+	    // the Newton generator and the reference are quadratic, too slow to compare here
+	    printf(" %12s %12.3f %12s %12s %12s %12.3e %12.3e\n","-",glrTime*1e3,"-","-","-",
+		   fabs((double)(sum - 2.0L)),exact);
+	    continue;
+	  }
+	std::shared_ptr<std::vector<double>> x,w;
+	double newtonTime = timeCall([&](){
+	    x = lobatto ? legendreTools::generateGLAbscissas(n,INT_MAX) : legendreTools::generateAbscissas(n,INT_MAX);
+	    w = lobatto ? legendreTools::generateGLWeights(n,x) : legendreTools::generateWeights(n,x);},0.05);
+	const std::vector<long double> reference = referenceWeights(n,lobatto,gx);
+	double dx = 0, dw = 0, dD = 0;
+	for(int i=0;i<n;i++)
+	  {
+	    dx = std::max(dx,fabs(x->at(i) - gx[i]));
+	    dw = std::max(dw,(double)fabsl((gw[i] - reference[i])/reference[i]));
+	  }
+	// the O(n) barycentric weights, as the product formula overflows at high order
+	std::shared_ptr<matrix<double>> D =
+	  legendreTools::generateDMat(n,x,legendreTools::generateBaryWeights(n,x,w,lobatto));
+	std::shared_ptr<matrix<double>> glrD =
+	  legendreTools::generateDMat(n,glr.first,legendreTools::generateBaryWeights(n,glr.first,glr.second,lobatto));
+	double Dmax = 0;
+	for(int i=0;i<n;i++)
+	  for(int j=0;j<n;j++)
+	    {
+	      dD = std::max(dD,fabs((*D)[i][j] - (*glrD)[i][j]));
+	      Dmax = std::max(Dmax,fabs((*D)[i][j]));
+	    }
+	printf(" %12.3f %12.3f %12.3e %12.3e %12.3e %12.3e %12.3e\n",newtonTime*1e3,glrTime*1e3,dx,dw,dD/Dmax,
+	       fabs((double)(sum - 2.0L)),exact);
+      }
+}
+
+/// Benchmarks evaluating P_0..P_n with first and second derivatives at a set
+/// of points: per order with boost::math::legendre_p and the closed-form
+/// derivatives (the former implementation), with the all-orders recurrence one
+/// point at a time, and with the batched recurrence. Reports the time per
+/// point and the largest derivative deviation away from the endpoints, where
+/// the closed form is singular.
+void benchLegendre()
+{
+  const size_t m = 256;
+  printf("%6s %14s %14s %14s %12s\n","n","boost ns/pt","all ns/pt","batch ns/pt","max |dP diff|");
+  for(int n : {8,20,64,256})
+    {
+      std::vector<double> xs(m);
+      for(size_t j=0;j<m;j++)
+	xs[j] = -0.999 + 1.998*j/(m - 1.0);
+      std::vector<double> P((n + 1)*m),dP((n + 1)*m),ddP((n + 1)*m),ref((n + 1)*m);
+      double boostTime = timeCall([&](){
+	  double sum = 0;
+	  for(size_t j=0;j<m;j++)
+	    for(int k=0;k<=n;k++)
+	      {
+		double x = xs[j];
+		double p = boost::math::legendre_p(k,x);
+		double dp = k ? k*(x*p - boost::math::legendre_p(k-1,x))/(x*x - 1) : 0;
+		double ddp = k*(((k - 1)*x*x - k - 1)*p + 2*x*boost::math::legendre_p(k-1,x))/pow(x*x - 1,2);
+		ref[k*m + j] = dp;
+		sum+=ddp;
+	      }
+	  keep(sum);},0.05);
+      double allTime = timeCall([&](){
+	  for(size_t j=0;j<m;j++)
+	    legendreTools::legendreAll(n,xs[j],P.data(),dP.data(),ddP.data());
+	  keep(ddP[n]);},0.05);
+      double batchTime = timeCall([&](){
+	  legendreTools::legendreAllBatch(n,xs.data(),m,P.data(),dP.data(),ddP.data());
+	  keep(ddP[n*m]);},0.05);
+      double maxDiff = 0;
+      for(size_t i=0;i<(n + 1)*m;i++)
+	maxDiff = std::max(maxDiff,fabs(dP[i] - ref[i])/std::max(1.0,fabs(ref[i])));
+      printf("%6d %14.1f %14.1f %14.1f %12.3e\n",n,boostTime/m*1e9,allTime/m*1e9,batchTime/m*1e9,maxDiff);
+    }
+}
+
+/// Benchmarks evaluating a Legendre series and its first two derivatives at
+/// plot resolution: summing terms from the all-orders recurrence, Clenshaw
+/// summation point by point, and batched Clenshaw summation. Reports the time
+/// per point and the largest deviation of the batched values from the
+/// term-by-term sums.
+void benchClenshaw()
+{
+  const size_t m = 300;
+  printf("%6s %14s %14s %14s %12s\n","n","terms ns/pt","clenshaw ns/pt","batch ns/pt","max |diff|");
+  for(int n : {8,20,64,256})
+    {
+      std::vector<double> c(n),xs(m),out(3*m),ref(3*m),P(n),dP(n),ddP(n);
+      for(int k=0;k<n;k++)
+	c[k] = 1.0/(1.0 + k);
+      for(size_t j=0;j<m;j++)
+	xs[j] = -1.0 + 2.0*j/(m - 1.0);
+      double termTime = timeCall([&](){
+	  for(size_t j=0;j<m;j++)
+	    {
+	      legendreTools::legendreAll(n-1,xs[j],P.data(),dP.data(),ddP.data());
+	      double f = 0, df = 0, ddf = 0;
+	      for(int k=0;k<n;k++)
+		{
+		  f+=c[k]*P[k];
+		  df+=c[k]*dP[k];
+		  ddf+=c[k]*ddP[k];
+		}
+	      ref[j] = f;
+	      ref[m + j] = df;
+	      ref[2*m + j] = ddf;
+	    }},0.05);
+      double clenshawTime = timeCall([&](){
+	  double sum = 0;
+	  for(size_t j=0;j<m;j++)
+	    {
+	      double f,df,ddf;
+	      legendreTools::clenshaw(c.data(),n,xs[j],f,df,ddf);
+	      sum+=f + df + ddf;
+	    }
+	  keep(sum);},0.05);
+      double batchTime = timeCall([&](){
+	  for(int d=0;d<3;d++)
+	    legendreTools::clenshawBatch(c.data(),n,xs.data(),out.data() + d*m,m,d);
+	  keep(out[0]);},0.05);
+      double maxDiff = 0;
+      for(size_t j=0;j<3*m;j++)
+	maxDiff = std::max(maxDiff,fabs(out[j] - ref[j])/std::max(1.0,fabs(ref[j])));
+      printf("%6d %14.1f %14.1f %14.1f %12.3e\n",n,termTime/m*1e9,clenshawTime/m*1e9,batchTime/m*1e9,maxDiff);
+    }
+}
+
+/// Benchmarks evaluating values and first derivatives of a history of
+/// snapshots on a fixed plot grid: per-point barycentric sums, batched
+/// Clenshaw summation, and one product with a prebuilt interpolationPlan.
+/// Reports microseconds per snapshot and the largest deviation from the
+/// per-point sums.
+void benchInterp()
+{
+  const int m = 300, steps = 100;
+  printf("%d points, %d snapshots, microseconds per snapshot\n",m,steps);
+  printf("%6s %14s %14s %14s %12s\n","n","barycentric","clenshaw","plan","max |diff|");
+  std::vector<double> xs;
+  for(int p=0;p<m;p++)
+    xs.push_back(-1.0 + 2.0*p/m);
+  for(int n : {8,20,64,256})
+    {
+      std::shared_ptr<spectralBasis> basis = spectralBasis::get(n,gaussLobattoNodes);
+      std::vector<scalarFunction> snapshots;
+      std::vector<double> nodal((size_t)steps*n);
+      for(int t=0;t<steps;t++)
+	{
+	  for(int i=0;i<n;i++)
+	    nodal[(size_t)t*n + i] = sin(3*basis->abscissas->at(i) + 0.01*t);
+	  snapshots.push_back(scalarFunction(basis,std::vector<double>(nodal.begin() + (size_t)t*n,nodal.begin() + (size_t)(t + 1)*n)));
+	}
+      std::vector<double> reference((size_t)2*steps*m),out((size_t)2*steps*m);
+      double baryTime = timeCall([&](){
+	  for(int t=0;t<steps;t++)
+	    for(int p=0;p<m;p++)
+	      {
+		reference[(size_t)2*t*m + p] = snapshots[t].at(xs[p],basis->baryWeights);
+		reference[(size_t)(2*t + 1)*m + p] = snapshots[t].dx(xs[p],basis->baryWeights);
+	      }},0.05);
+      double clenshawTime = timeCall([&](){
+	  for(int t=0;t<steps;t++)
+	    {
+	      snapshots[t].invalidate();
+	      snapshots[t].evaluate(xs.data(),out.data() + (size_t)2*t*m,m);
+	      snapshots[t].evaluate(xs.data(),out.data() + (size_t)(2*t + 1)*m,m,1);
+	    }},0.05);
+      interpolationPlan plan(basis,xs);
+      double planTime = timeCall([&](){
+	  plan.apply(nodal.data(),n,out.data(),2*m,steps);
+	  plan.apply(nodal.data(),n,out.data() + m,2*m,steps,1);},0.05);
+      double maxDiff = 0;
+      for(size_t i=0;i<out.size();i++)
+	maxDiff = std::max(maxDiff,fabs(out[i] - reference[i]));
+      printf("%6d %14.2f %14.2f %14.2f %12.3e\n",n,baryTime/steps*1e6,clenshawTime/steps*1e6,planTime/steps*1e6,maxDiff);
+    }
+}
+
+/// Benchmarks computing the spectral coefficients of a long history: one
+/// quadSum() per snapshot against the batched single-product transform, on one
+/// thread and on every available core. Reports milliseconds per history and
+/// the largest deviation between the two.
+/// \param steps number of timesteps in the history
+void benchHistory(int steps)
+{
+  const int threads = std::max(1u,std::thread::hardware_concurrency());
+  printf("%d timesteps, batched transform on 1 and %d threads\n",steps,threads);
+  printf("%6s %14s %14s %14s %12s\n","n","quadSum ms","batched ms","threaded ms","max |diff|");
+  for(int n : {8,20,64,128})
+    {
+      std::shared_ptr<spectralBasis> basis = spectralBasis::get(n,gaussNodes);
+      functionStateHistory history;
+      for(int t=0;t<steps;t++)
+	{
+	  std::vector<double> data(n);
+	  for(int i=0;i<n;i++)
+	    data[i] = cos(2*(basis->abscissas->at(i) + 0.01*t));
+	  history.timeStates.push_back(scalarFunction(basis,data));
+	}
+      std::vector<std::vector<double>> reference(steps);
+      double loopTime = timeCall([&](){
+	  for(int t=0;t<steps;t++)
+	    {
+	      history.timeStates[t].quadSum();
+	      reference[t] = *history.timeStates[t].spectralData;
+	    }},0.05);
+      double batchTime = timeCall([&](){ history.computeSpectralData(1);},0.05);
+      double threadTime = timeCall([&](){ history.computeSpectralData(threads);},0.05);
+      double maxDiff = 0;
+      for(int t=0;t<steps;t++)
+	for(int i=0;i<n;i++)
+	  maxDiff = std::max(maxDiff,fabs(history.timeStates[t].spectralData->at(i) - reference[t][i]));
+      printf("%6d %14.3f %14.3f %14.3f %12.3e\n",n,loopTime*1e3,batchTime*1e3,threadTime*1e3,maxDiff);
+    }
+}
+
+/// Benchmarks the fast Legendre transform against the dense nodal-to-modal
+/// product, reporting microseconds per vector, the Hankel rank, and the
+/// largest deviation from the dense transform relative to the largest
+/// coefficient, for both node families. The crossover order is the smallest
+/// measured order from which the fast transform stays faster; when it never
+/// is, the crossover is extrapolated from the n^2 and n log n trends of the
+/// largest order measured.
+/// \param calibrationFile file to record the crossover in, for
+/// spectralBasis::fastTransformOrder(), or empty to only report
+void benchFastLegendre(const std::string &calibrationFile)
+{
+  printf("%6s %8s %12s %12s %6s %12s\n","n","family","dense us","fast us","rank","max rel err");
+  std::vector<int> orders;
+  for(int n=64;n<=4096;n*=2)
+    {
+      orders.push_back(n);
+      if(n < 4096)
+	orders.push_back(3*n/2);
+    }
+  int crossover = INT_MAX;
+  double lastDense = 0, lastFast = 0;
+  for(int n : orders)
+    for(bool lobatto : {false,true})
+      {
+	spectralBasis basis(n,lobatto ? gaussLobattoNodes : gaussNodes);
+	std::shared_ptr<const matrix<double>> F = basis.forwardTransform();
+	std::shared_ptr<const fastLegendreTransform> FLT = basis.fastTransform();
+	std::vector<double> nodal(n),dense(n),fast(n);
+	for(int j=0;j<n;j++)
+	  nodal[j] = exp(-4*basis.abscissas->at(j))*sin(40*basis.abscissas->at(j)) + ((j*7919)%13)/13.0;
+	double denseTime = timeCall([&](){ F->apply(nodal.data(),dense.data());},0.05);
+	double fastTime = timeCall([&](){ FLT->forward(nodal.data(),fast.data());},0.05);
+	double maxDiff = 0, maxCoeff = 0;
+	for(int i=0;i<n;i++)
+	  {
+	    maxDiff = std::max(maxDiff,fabs(fast[i] - dense[i]));
+	    maxCoeff = std::max(maxCoeff,fabs(dense[i]));
+	  }
+	printf("%6d %8s %12.2f %12.2f %6d %12.3e\n",n,lobatto ? "lobatto" : "gauss",denseTime*1e6,fastTime*1e6,
+	       FLT->rank(),maxDiff/maxCoeff);
+	if(lobatto)
+	  continue;
+	if(fastTime < denseTime)
+	  crossover = std::min(crossover,n);
+	else
+	  crossover = INT_MAX;
+	lastDense = denseTime;
+	lastFast = fastTime;
+      }
+  if(crossover == INT_MAX)
+    {
+      // dense grows like n^2 and fast like n log n from the largest order measured
+      const double n0 = orders.back();
+      double n = n0;
+      while(lastDense*(n/n0)*(n/n0) <= lastFast*(n/n0)*log(n)/log(n0) && n < 1e7)
+	n*=1.1;
+      crossover = n;
+      printf("fast transform not yet faster; extrapolated ");
+    }
+  printf("crossover order %d\n",crossover);
+  if(calibrationFile.empty())
+    return;
+  boost::filesystem::path path(calibrationFile);
+  if(path.has_parent_path())
+    boost::filesystem::create_directories(path.parent_path());
+  FILE* file = fopen(calibrationFile.c_str(),"w");
+  if(!file)
+    {
+      printf("could not write calibration file %s\n",calibrationFile.c_str());
+      return;
+    }
+  fprintf(file,"flt_order %d\n",crossover);
+  fclose(file);
+  printf("wrote %s\n",calibrationFile.c_str());
+}
+
+/// The DG right-hand side as implemented before the boundary traces were
+/// taken from the interpolants: a scalarFunction per domain and field, each
+/// evaluated at +/-1 through its spectral coefficients. Kept here as the
+/// benchmark reference.
+/// \param wave the DG wave
+/// \param x the set of flattened collocation points
+/// \param dxdt the time derivatives, populated as return parameter
+/// \param t simulation time
+void legacyDGRHS(DGTransmittingMultiWave &wave, const std::vector<double> &x, std::vector<double> &dxdt, double t)
+{
+  const int doms = wave.doms;
+  const std::vector<int> &n = wave.n;
+  std::vector<double> rightfluxpi,rightfluxpsi,leftfluxpi,leftfluxpsi;
+  std::vector<scalarFunction> pis,psis;
+  int elstart=0;
+  for(int d=0;d<doms;d++)
+    {
+      pis.push_back(scalarFunction(wave.bases[d],std::vector<double>(x.begin()+ elstart,x.begin()+elstart+n[d])));
+      psis.push_back(scalarFunction(wave.bases[d],std::vector<double>(x.begin()+elstart+n[d],x.begin()+elstart+ 2*n[d])));
+      elstart+=2*n[d];
+    }
+  rightfluxpi.push_back(wave.boundData(t+1.0));
+  rightfluxpsi.push_back(-wave.boundData(t+1.0));
+  for(int d=0;d<doms;d++)
+    {
+      leftfluxpi.push_back((pis[d].at(-1.0) + psis[d].at(-1.0))/2.0);
+      rightfluxpi.push_back((pis[d].at(1.0) - psis[d].at(1.0))/2.0);
+      leftfluxpsi.push_back((pis[d].at(-1.0) + psis[d].at(-1.0))/2.0);
+      rightfluxpsi.push_back((-pis[d].at(1.0) + psis[d].at(1.0))/2.0);
+    }
+  leftfluxpi.push_back(wave.reflect ? -rightfluxpi[doms]: 0);
+  leftfluxpsi.push_back(wave.reflect ? -rightfluxpi[doms]: 0);
+  wave.applyDerivatives(x.data(),dxdt.data());
+  elstart=0;
+  for(int d=0;d<doms;d++)
+    {
+      for(int i=0;i<n[d];i++)
+	{
+	  dxdt[elstart + i] += ((leftfluxpi[d+1] - rightfluxpi[d+1])*(*wave.rightInterpolant[d])[i]/wave.weights[d]->at(i)
+				-(leftfluxpi[d] - rightfluxpi[d])*(*wave.leftInterpolant[d])[i]/wave.weights[d]->at(i));
+	  dxdt[elstart + i + n[d]] += ((leftfluxpsi[d+1] - rightfluxpsi[d+1])*(*wave.rightInterpolant[d])[i]/wave.weights[d]->at(i)
+				       -(leftfluxpsi[d] - rightfluxpsi[d])*(*wave.leftInterpolant[d])[i]/wave.weights[d]->at(i));
+	}
+      elstart+=2*n[d];
+    }
+}
+
+/// Benchmarks the DG right-hand side with boundary traces taken as dot
+/// products with the interpolants against the legacy per-RHS scalarFunction
+/// evaluation, reporting microseconds per RK4 step (four evaluations) and the
+/// largest deviation between the two
+/// \param doms number of domains
+void benchDGTraces(int doms)
+{
+  printf("DG wave with %d domains, microseconds per RK4 step\n",doms);
+  printf("%6s %14s %14s %10s %12s\n","n","legacy","traces","speedup","max |diff|");
+  for(int order : {20,64,256})
+    {
+      std::vector<double> x;
+      std::shared_ptr<multiDomainWave> base = makeWave(true,doms,order,x);
+      DGTransmittingMultiWave &wave = static_cast<DGTransmittingMultiWave&>(*base);
+      std::vector<double> reference(x.size()),dxdt(x.size());
+      double legacyTime = timeCall([&](){ legacyDGRHS(wave,x,reference,0.5);});
+      double traceTime = timeCall([&](){ wave(x,dxdt,0.5);});
+      double maxDiff = 0;
+      for(size_t i=0;i<x.size();i++)
+	maxDiff = std::max(maxDiff,fabs(dxdt[i] - reference[i]));
+      printf("%6d %14.3f %14.3f %10.2f %12.3e\n",order,4*legacyTime*1e6,4*traceTime*1e6,legacyTime/traceTime,maxDiff);
+    }
+}
+
+/// Benchmarks one right-hand-side evaluation of the wave for each derivative
+/// engine and for the automatic choice among them, reporting the time per call
+/// and the largest deviation from the dense engine
+/// \param isDG true for the discontinuous Galerkin wave, false for collocation
+/// \param domList the numbers of domains to run
+/// \param ordList the spectral orders to run
+/// \param chebyshev true to run collocation on Chebyshev points, adding the FFT engine
+/// \param threads number of threads evaluating the right-hand side
+void benchRHS(bool isDG, std::vector<int> domList, std::vector<int> ordList, bool chebyshev, int threads)
+{
+  std::vector<std::pair<derivativeEngine,const char*>> engines =
+    {{denseDerivatives,"dense"},{batchedDerivatives,"batched"},{evenOddDerivatives,"evenodd"},
+     {fixedDerivatives,"fixed"}};
+  if(chebyshev)
+    engines.push_back({fftDerivatives,"fft"});
+  engines.push_back({automaticDerivatives,"auto"});
+  printf("%s wave%s, microseconds per RHS evaluation on %d thread%s\n",isDG ? "DG" : "collocation",
+	 chebyshev ? " on Chebyshev points" : "",threads,threads > 1 ? "s" : "");
+  printf("%6s %6s","doms","n");
+  for(auto &e : engines)
+    printf(" %12s",e.second);
+  printf(" %12s\n","max |diff|");
+  for(int doms : domList)
+    for(int order : ordList)
+      {
+	std::vector<double> x;
+	std::shared_ptr<multiDomainWave> wave = makeWave(isDG,doms,order,x,chebyshev);
+	wave->setThreads(threads);
+	std::vector<double> reference(x.size());
+	std::vector<double> dxdt(x.size());
+	double maxDiff = 0;
+	printf("%6d %6d",doms,order);
+	for(auto &e : engines)
+	  {
+	    wave->engine = e.first;
+	    double t = timeCall([&](){ (*wave)(x,dxdt,0.5);});
+	    if(e.first == denseDerivatives)
+	      reference = dxdt;
+	    for(size_t i=0;i<x.size();i++)
+	      maxDiff = std::max(maxDiff,fabs(dxdt[i] - reference[i]));
+	    printf(" %12.3f",t*1e6);
+	  }
+	printf(" %12.3e\n",maxDiff);
+      }
+}
+
+/// Benchmarks right-hand side evaluation on the thread pool for a wave of
+/// many domains with heterogeneous orders, cycling through 8 to 64, at
+/// thread counts doubling up to the given maximum. Reports the speedup over
+/// one thread and the largest deviation from the serial result.
+/// \param doms number of domains
+/// \param maxThreads largest number of threads
+void benchScaling(int doms, int maxThreads)
+{
+  const int cycle[] = {8,12,16,20,24,32,48,64};
+  std::vector<int> orders;
+  for(int d=0;d<doms;d++)
+    orders.push_back(cycle[d%8]);
+  printf("%d domains of orders 8 to 64, microseconds per RHS evaluation\n",doms);
+  printf("%6s %8s %12s %10s %12s\n","wave","threads","time","speedup","max |diff|");
+  for(bool isDG : {true,false})
+    {
+      std::vector<double> x;
+      std::shared_ptr<multiDomainWave> wave = makeWave(isDG,orders,x);
+      std::vector<double> reference(x.size()),dxdt(x.size());
+      (*wave)(x,reference,0.5);
+      double serial = 0;
+      for(int threads=1;;threads=std::min(2*threads,maxThreads))
+	{
+	  wave->setThreads(threads);
+	  double t = timeCall([&](){ (*wave)(x,dxdt,0.5);});
+	  if(threads == 1)
+	    serial = t;
+	  double maxDiff = 0;
+	  for(size_t i=0;i<x.size();i++)
+	    maxDiff = std::max(maxDiff,fabs(dxdt[i] - reference[i]));
+	  printf("%6s %8d %12.3f %10.2f %12.3e\n",isDG ? "DG" : "coll",threads,t*1e6,serial/t,maxDiff);
+	  if(threads >= maxThreads)
+	    break;
+	}
+    }
+}
+
+/// Compares the right-hand side run as a task graph with the bulk-synchronous
+/// schedule of the same tasks, on a wave of many domains with heterogeneous
+/// orders. From a traced graph run it reports the total work and the
+/// critical path of both schedules: the longest chain of dependent tasks for
+/// the graph, the sum of each phase's longest task with barriers.
+/// \param doms number of domains
+/// \param threads number of threads
+/// \param traceFile if not empty, the per-task timeline of the traced runs is written here
+void benchTaskGraph(int doms, int threads, const std::string &traceFile)
+{
+  const int cycle[] = {8,12,16,20,24,32,48,64};
+  std::vector<int> orders;
+  for(int d=0;d<doms;d++)
+    orders.push_back(cycle[d%8]);
+  FILE* out = traceFile.empty() ? nullptr : fopen(traceFile.c_str(),"w");
+  if(out)
+    fprintf(out,"# wave task phase thread start_us end_us\n");
+  printf("%d domains of orders 8 to 64 on %d threads, microseconds per RHS evaluation\n",doms,threads);
+  printf("%6s %8s %12s %12s %12s %12s %12s\n","wave","tasks","barrier","graph","work","barrier cp","graph cp");
+  auto compare = [&](auto* wave, const char* name, std::vector<double> &x){
+    wave->setThreads(threads);
+    std::vector<double> dxdt(x.size());
+    wave->useTaskGraph = false;
+    double barrier = timeCall([&](){ (*wave)(x,dxdt,0.5);});
+    wave->useTaskGraph = true;
+    double graph = timeCall([&](){ (*wave)(x,dxdt,0.5);});
+    // the median traced run of several, as single runs are noisy
+    std::vector<std::vector<taskGraph::record>> traces(15);
+    std::vector<std::pair<double,int>> paths;
+    for(int r=0;r<(int)traces.size();r++)
+      {
+	wave->evaluate(x,dxdt,0.5,&traces[r]);
+	paths.push_back({wave->graph->criticalPath(traces[r]),r});
+      }
+    std::sort(paths.begin(),paths.end());
+    const std::vector<taskGraph::record> &trace = traces[paths[paths.size()/2].second];
+    const int B = wave->blocks.size();
+    double work = 0;
+    for(const taskGraph::record &rec : trace)
+      work+=rec.end - rec.start;
+    printf("%6s %8d %12.3f %12.3f %12.3f %12.3f %12.3f\n",name,2*B,barrier*1e6,graph*1e6,work*1e6,
+	   wave->graph->phasedCriticalPath(trace)*1e6,wave->graph->criticalPath(trace)*1e6);
+    if(out)
+      for(int t=0;t<(int)trace.size();t++)
+	fprintf(out,"%s %d %d %d %.3f %.3f\n",name,t,t >= B,trace[t].thread,trace[t].start*1e6,trace[t].end*1e6);
+  };
+  std::vector<double> x;
+  std::shared_ptr<multiDomainWave> dg = makeWave(true,orders,x);
+  compare(dynamic_cast<DGTransmittingMultiWave*>(dg.get()),"DG",x);
+  std::shared_ptr<multiDomainWave> coll = makeWave(false,orders,x);
+  compare(dynamic_cast<collTransmittingMultiWave*>(coll.get()),"coll",x);
+  if(out)
+    fclose(out);
+}
+
+/// Benchmarks the vector algebra of one RK4 step (three two-term stage
+/// combinations and the five-term update) with odeint's range_algebra
+/// against waveAlgebra, serially and on the wave's threads, for the state
+/// of a DG wave
+/// \param doms number of domains
+/// \param order spectral order of each domain
+/// \param threads number of threads for the parallel run
+void benchAlgebra(int doms, int order, int threads)
+{
+  using namespace boost::numeric::odeint;
+  std::vector<double> x;
+  std::shared_ptr<multiDomainWave> wave = makeWave(true,doms,order,x);
+  const size_t size = x.size();
+  std::vector<double> k1(size),k2(size),k3(size),k4(size),tmp(size),out(size);
+  for(size_t i=0;i<size;i++)
+    {
+      k1[i] = sin(0.1*i);
+      k2[i] = cos(0.2*i);
+      k3[i] = sin(0.3*i + 1);
+      k4[i] = cos(0.4*i + 2);
+    }
+  const double dt = 1e-3;
+  auto step = [&](const auto &algebra){
+    algebra.for_each3(tmp,x,k1,default_operations::scale_sum2<double,double>(1.0,dt/2));
+    algebra.for_each3(tmp,x,k2,default_operations::scale_sum2<double,double>(1.0,dt/2));
+    algebra.for_each3(tmp,x,k3,default_operations::scale_sum2<double,double>(1.0,dt));
+    algebra.for_each6(out,x,k1,k2,k3,k4,
+		      default_operations::scale_sum5<double,double,double,double,double>(1.0,dt/6,dt/3,dt/3,dt/6));
+  };
+  printf("RK4 step algebra on a state of %zu doubles (%d domains of order %d), microseconds\n",size,doms,order);
+  printf("%14s %14s %14s %10s %12s\n","range_algebra","waveAlgebra","threaded","threads","max |diff|");
+  range_algebra range;
+  double tRange = timeCall([&](){ step(range);});
+  std::vector<double> reference = out;
+  waveAlgebra serial;
+  double tSerial = timeCall([&](){ step(serial);});
+  double diff = 0;
+  for(size_t i=0;i<size;i++)
+    diff = std::max(diff,fabs(out[i] - reference[i]));
+  wave->setThreads(threads);
+  waveAlgebra parallel(wave.get());
+  double tParallel = timeCall([&](){ step(parallel);});
+  for(size_t i=0;i<size;i++)
+    diff = std::max(diff,fabs(out[i] - reference[i]));
+  printf("%14.3f %14.3f %14.3f %10d %12.3e\n",tRange*1e6,tSerial*1e6,tParallel*1e6,threads,diff);
+}
+
+/// Compares a step of odeint's RK4 with the wave algebra against the
+/// low-storage Runge-Kutta stepper, with its stage update applied as a
+/// separate pass over the state and folded into the right-hand side, for a
+/// DG and a collocation wave, serially and on the wave's threads. Also
+/// reports the state-sized buffers each stepper keeps besides the state and
+/// the deviation of the fused stepper from the unfused one, and from RK4,
+/// after a fixed number of steps.
+/// \param doms number of domains
+/// \param order spectral order of each domain
+/// \param threads number of threads for the parallel runs
+void benchStepper(int doms, int order, int threads)
+{
+  using namespace boost::numeric::odeint;
+  // hides the wave's type from the stepper, so that it takes the unfused path
+  struct plainSystem
+  {
+    multiDomainWave* wave; ///< the wave evaluated
+    void operator()(const std::vector<double> &x, std::vector<double> &dxdt, const double t){
+      (*wave)(x,dxdt,t);}
+  };
+  const double dt = 1e-3;
+  const int steps = 100;
+  printf("one time step on %d domains of order %d, microseconds; buffers besides the state: rk4 5, lsrk 2\n",
+	 doms,order);
+  printf("%12s %8s %12s %12s %12s %14s %14s\n","wave","threads","rk4","lsrk","lsrk fused","fused-unfused",
+	 "lsrk-rk4");
+  for(bool isDG : {true,false})
+    for(int t : {1,threads})
+      {
+	std::vector<double> x;
+	std::shared_ptr<multiDomainWave> wave = makeWave(isDG,doms,order,x);
+	wave->setThreads(t);
+	plainSystem plain{wave.get()};
+	runge_kutta4<std::vector<double>,double,std::vector<double>,double,waveAlgebra,default_operations>
+	  rk((waveAlgebra(wave.get())));
+	lowStorageRK unfused, fused;
+	std::vector<double> xRK = x, xUnfused = x, xFused = x;
+	double tRK = timeCall([&](){ rk.do_step(boost::ref(*wave),xRK,0.0,dt);});
+	double tUnfused = timeCall([&](){ unfused.do_step(plain,xUnfused,0.0,dt);});
+	double tFused = timeCall([&](){ fused.do_step(*wave,xFused,0.0,dt);});
+	xRK = xUnfused = xFused = x;
+	for(int s=0;s<steps;s++)
+	  {
+	    rk.do_step(boost::ref(*wave),xRK,s*dt,dt);
+	    unfused.do_step(plain,xUnfused,s*dt,dt);
+	    fused.do_step(*wave,xFused,s*dt,dt);
+	  }
+	double fusedDiff = 0, rkDiff = 0;
+	for(size_t i=0;i<x.size();i++)
+	  {
+	    fusedDiff = std::max(fusedDiff,fabs(xFused[i] - xUnfused[i]));
+	    rkDiff = std::max(rkDiff,fabs(xFused[i] - xRK[i]));
+	  }
+	printf("%12s %8d %12.3f %12.3f %12.3f %14.3e %14.3e\n",isDG ? "DG" : "collocation",t,tRK*1e6,
+	       tUnfused*1e6,tFused*1e6,fusedDiff,rkDiff);
+	if(threads == 1)
+	  break;
+      }
+}
+
+int main(int argv, char * args[])
+{
+  boost::program_options::options_description desc("Options");
+  desc.add_options()
+    ("help","show this help message")
+    ("gemm","benchmark the blocked matrix product against the reference triple loop")
+    ("fixed","benchmark the fixed-order kernels against the generic loops for each order")
+    ("fused","benchmark the fused pi/psi operator product with folded DG lift against separate products")
+    ("nodes","cross-validate and time the O(n) node generator against Newton-Raphson")
+    ("legendre","benchmark the all-orders Legendre recurrence against per-order boost evaluation")
+    ("clenshaw","benchmark Clenshaw evaluation of Legendre series against term-by-term summation")
+    ("interp","benchmark evaluating snapshots on a fixed grid with an interpolation plan against per-point evaluation")
+    ("history",boost::program_options::value<int>()->implicit_value(10000),"benchmark transforming a history of the given number of timesteps to spectral coefficients")
+    ("flt","benchmark the fast Legendre transform against the dense transform and report its accuracy")
+    ("calibrate-flt",boost::program_options::value<std::string>(),"run --flt and record the crossover order in the given calibration file")
+    ("dg-trace","benchmark the DG right-hand side with interpolant boundary traces against per-RHS scalarFunction evaluation")
+    ("rhs","benchmark wave right-hand-side evaluation for each derivative engine")
+    ("scaling","benchmark right-hand-side evaluation of many heterogeneous-order domains on 1 to --threads threads")
+    ("algebra","benchmark the RK4 stage updates with odeint's range_algebra against the wave algebra, serial and threaded")
+    ("stepper","benchmark a step of odeint's RK4 against the low-storage Runge-Kutta stepper, unfused and fused into the right-hand side")
+    ("dag","compare the task graph right-hand side with the barrier-separated phases, with critical paths from a trace")
+    ("trace",boost::program_options::value<std::string>(),"file to write the per-task timeline of --dag to")
+    ("threads",boost::program_options::value<int>(),"number of threads for --rhs, --dag, --algebra and --stepper, largest number for --scaling")
+    ("type",boost::program_options::value<std::string>(),"type of spectral simulation for --rhs (coll,dg)")
+    ("dom",boost::program_options::value<std::vector<int>>()->multitoken(),"numbers of domains for --rhs")
+    ("ord",boost::program_options::value<std::vector<int>>()->multitoken(),"spectral orders for --rhs")
+    ("basis",boost::program_options::value<std::string>(),"collocation basis for --rhs with type coll (legendre,cheb)");
+
+  boost::program_options::variables_map vars;
+  boost::program_options::store(boost::program_options::parse_command_line(argv,args,desc),vars);
+
+  if(vars.count("help") || vars.empty()) {
+    desc.print(std::cout);
+    return 1;
+  }
+
+  if(vars.count("gemm"))
+    benchGemm();
+  if(vars.count("fixed"))
+    benchFixed();
+  if(vars.count("fused"))
+    benchFused();
+  if(vars.count("nodes"))
+    benchNodes();
+  if(vars.count("legendre"))
+    benchLegendre();
+  if(vars.count("clenshaw"))
+    benchClenshaw();
+  if(vars.count("interp"))
+    benchInterp();
+  if(vars.count("history"))
+    benchHistory(vars["history"].as<int>());
+  if(vars.count("flt") || vars.count("calibrate-flt"))
+    benchFastLegendre(vars.count("calibrate-flt") ? vars["calibrate-flt"].as<std::string>() : "");
+  if(vars.count("dg-trace"))
+    benchDGTraces(vars.count("dom") ? vars["dom"].as<std::vector<int>>()[0] : 2);
+  if(vars.count("rhs"))
+    {
+      bool isDG = !(vars.count("type") && vars["type"].as<std::string>() == "coll");
+      std::vector<int> domList = vars.count("dom") ? vars["dom"].as<std::vector<int>>() : std::vector<int>({2,16,200});
+      std::vector<int> ordList = vars.count("ord") ? vars["ord"].as<std::vector<int>>() : std::vector<int>({8,20,64});
+      bool chebyshev = !isDG && vars.count("basis") && vars["basis"].as<std::string>() == "cheb";
+      benchRHS(isDG,domList,ordList,chebyshev,vars.count("threads") ? vars["threads"].as<int>() : 1);
+    }
+  if(vars.count("algebra"))
+    benchAlgebra(vars.count("dom") ? vars["dom"].as<std::vector<int>>()[0] : 500,
+		 vars.count("ord") ? vars["ord"].as<std::vector<int>>()[0] : 64,
+		 vars.count("threads") ? vars["threads"].as<int>() : std::max(1u,std::thread::hardware_concurrency()));
+  if(vars.count("stepper"))
+    benchStepper(vars.count("dom") ? vars["dom"].as<std::vector<int>>()[0] : 500,
+		 vars.count("ord") ? vars["ord"].as<std::vector<int>>()[0] : 64,
+		 vars.count("threads") ? vars["threads"].as<int>() : std::max(1u,std::thread::hardware_concurrency()));
+  if(vars.count("dag"))
+    benchTaskGraph(vars.count("dom") ? vars["dom"].as<std::vector<int>>()[0] : 500,
+		   vars.count("threads") ? vars["threads"].as<int>() : std::max(1u,std::thread::hardware_concurrency()),
+		   vars.count("trace") ? vars["trace"].as<std::string>() : "");
+  if(vars.count("scaling"))
+    benchScaling(vars.count("dom") ? vars["dom"].as<std::vector<int>>()[0] : 500,
+		 vars.count("threads") ? vars["threads"].as<int>() : std::max(1u,std::thread::hardware_concurrency()));
+  return 0;
+}
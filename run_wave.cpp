@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <boost/program_options.hpp>
 #include "multiDomainWave.hpp"
+#include "waveAlgebra.hpp"
+#include "lowStorageRK.hpp"
 #include "scalarWavePlots.hpp"
 
 /// Template metaprogramming type-checker using SFINAE to verify that the
@@ -46,14 +48,24 @@ struct checkWaveEval
 /// \param duration final time of the system
 /// \param stepSize time step
 /// \param waveHist history object to record the states to.
+/// \param lowStorage whether to step with the fused low-storage scheme rather than classic RK4
 void odeEvolve(std::vector<double> initial, auto &wave, double duration, double stepSize,
-		     auto &waveHist){
+		     auto &waveHist, bool lowStorage = false){
   static_assert(checkHistoryEval<typename std::remove_reference<decltype(waveHist)>::type >::value,
 		"odeEvolve was passed an invalid History with which to record");
   static_assert(checkWaveEval<typename std::remove_reference<decltype(wave)>::type >::value,
 		"odeEvolve was passed an invalid wave to evolve");
-  boost::numeric::odeint::runge_kutta4<std::vector<double>> rk;
-  size_t steps =  boost::numeric::odeint::integrate_const(rk,wave,initial,0.0,duration,stepSize,waveHist);
+  size_t steps;
+  if(lowStorage)
+    // the stage updates are applied by the wave itself as it evaluates each block
+    steps = boost::numeric::odeint::integrate_const(lowStorageRK(),wave,initial,0.0,duration,stepSize,waveHist);
+  else
+    {
+      // the stage updates run on the wave's threads, over the same domains as its right-hand side
+      boost::numeric::odeint::runge_kutta4<std::vector<double>,double,std::vector<double>,double,waveAlgebra,
+					   boost::numeric::odeint::default_operations> rk((waveAlgebra(&wave)));
+      steps = boost::numeric::odeint::integrate_const(rk,wave,initial,0.0,duration,stepSize,waveHist);
+    }
   printf("\ncompleted! number of steps: %d\n",(int)steps);
 }
 
@@ -72,6 +84,12 @@ int main(int argv, char * args[])
     ("step",boost::program_options::value<double>(),"size of simulation timestep")
     ("type",boost::program_options::value<std::string>(),"type of spectral simulation (coll,dg)")
     ("ord",boost::program_options::value<int>(),"spectral order")
+    ("deriv",boost::program_options::value<std::string>(),"derivative engine (auto,dense,batched,evenodd,fixed,fft)")
+    ("basis",boost::program_options::value<std::string>(),"collocation basis (legendre,cheb)")
+    ("basis-cache",boost::program_options::value<std::string>(),"directory of the on-disk basis cache")
+    ("threads",boost::program_options::value<int>(),"number of threads evaluating the domains of the right-hand side")
+    ("stepper",boost::program_options::value<std::string>(),"time stepper (rk4,lsrk)")
+    ("validate","compare even-odd derivative products against the dense operator")
     ("no-vis","turn off default visualizations")
     ("verbose","turn on periodic status updates during simulation");
 
@@ -120,6 +138,52 @@ int main(int argv, char * args[])
 	printf("type specified but does not match flags, defualting to transmit\n");
     }
   
+  derivativeEngine engine = automaticDerivatives;
+  if(vars.count("deriv"))
+    {
+      if(vars["deriv"].as<std::string>() == "dense")
+	engine = denseDerivatives;
+      else if(vars["deriv"].as<std::string>() == "batched")
+	engine = batchedDerivatives;
+      else if(vars["deriv"].as<std::string>() == "evenodd")
+	engine = evenOddDerivatives;
+      else if(vars["deriv"].as<std::string>() == "fixed")
+	engine = fixedDerivatives;
+      else if(vars["deriv"].as<std::string>() == "fft")
+	engine = fftDerivatives;
+      else if(vars["deriv"].as<std::string>() != "auto")
+	printf("deriv specified but does not match flags, defaulting to auto\n");
+    }
+  nodeFamily family = isDG ? gaussNodes : gaussLobattoNodes;
+  if(vars.count("basis"))
+    {
+      if(vars["basis"].as<std::string>() == "cheb")
+	{
+	  if(isDG)
+	    printf("cheb basis is only available with type coll, defaulting to legendre\n");
+	  else
+	    family = chebyshevLobattoNodes;
+	}
+      else if(vars["basis"].as<std::string>() != "legendre")
+	printf("basis specified but does not match flags, defaulting to legendre\n");
+    }
+  if(vars.count("basis-cache"))
+    spectralBasis::setCacheDirectory(vars["basis-cache"].as<std::string>());
+  bool validate = (bool)(vars.count("validate"));
+  int threads = vars.count("threads") ? vars["threads"].as<int>() : 1;
+  if(validate && threads > 1)
+    {
+      printf("validation is single-threaded, ignoring threads\n");
+      threads = 1;
+    }
+  bool lowStorage = false;
+  if(vars.count("stepper"))
+    {
+      if(vars["stepper"].as<std::string>() == "lsrk")
+	lowStorage = true;
+      else if(vars["stepper"].as<std::string>() != "rk4")
+	printf("stepper specified but does not match flags, defaulting to rk4\n");
+    }
   bool dumpData = (bool)(vars.count("data"));
   bool verb = (bool)(vars.count("verbose"));
   bool vis = !(bool)(vars.count("no-vis"));
@@ -142,18 +206,14 @@ int main(int argv, char * args[])
 
   std::vector<elementStateHistory> states;
 	  
-  std::vector<std::shared_ptr<std::vector<double>>> abscissas(doms);
-  std::vector<std::shared_ptr<std::vector<double>>> weights(doms);
-  std::vector<std::shared_ptr<matrix<double>>> DMats(doms);
-  
-  std::transform(orders.begin(),orders.end(),abscissas.begin(),
-		 isDG ? legendreTools::generateAbscissas : legendreTools::generateGLAbscissas);
-  std::transform(orders.begin(),orders.end(),abscissas.begin(),weights.begin(),
-		 isDG ? legendreTools::generateWeights : legendreTools::generateGLWeights);
-  std::transform(orders.begin(),orders.end(),abscissas.begin(),DMats.begin(),
-		 [](auto ord, auto absc){
-		   return legendreTools::generateDMat(ord,absc,legendreTools::generateBaryWeights(ord,absc));} );
-  
+  //each (order, node family) basis is generated once and shared by every domain using it
+  std::vector<std::shared_ptr<spectralBasis>> bases;
+  std::vector<std::shared_ptr<std::vector<double>>> abscissas;
+  for(int d=0;d<doms;d++)
+    {
+      bases.push_back(spectralBasis::get(orders[d],family));
+      abscissas.push_back(bases[d]->abscissas);
+    }
   
   for(int d=0;d<doms;d++)
     {
@@ -168,12 +228,21 @@ int main(int argv, char * args[])
   for(int d=0;d<doms;d++)
     {
       states.push_back(elementStateHistory());
+      // only attached when the operator has an exact even-odd form
+      std::shared_ptr<evenOddMatrix<double>> evenOdd;
+      if(engine == evenOddDerivatives)
+	{
+	  evenOdd = std::shared_ptr<evenOddMatrix<double>>(new evenOddMatrix<double>(*bases[d]->DMat));
+	  if(!evenOdd->valid)
+	    evenOdd = NULL;
+	}
       for(int i=0;i<2;i++)
 	{
 	  states[d].functionStates.push_back(functionStateHistory());
-	  states[d].functionStates[i].timeStates.push_back(scalarFunction(orders[d],abscissas[d],weights[d],DMats[d],
+	  states[d].functionStates[i].timeStates.push_back(scalarFunction(bases[d],
 									  std::vector<double>(x.begin()+elstart+i*orders[d]
 											      ,x.begin()+elstart+(i+1)*orders[d])));
+	  states[d].functionStates[i].timeStates[0].evenOddDMat = evenOdd;
 	}
       elstart+=2*orders[d];
     }
@@ -183,13 +252,23 @@ int main(int argv, char * args[])
   if(verb) printf("initializing ode integrator \n");
   if(isDG)
     {
-      auto wave = DGTransmittingMultiWave(orders,abscissas,weights,DMats,doms,boundData,isReflecting,verb);
-      odeEvolve(x,wave,duration,step,waveHist);
+      auto wave = DGTransmittingMultiWave(bases,boundData,isReflecting,verb);
+      wave.engine = engine;
+      wave.setThreads(threads);
+      wave.setValidation(validate);
+      odeEvolve(x,wave,duration,step,waveHist,lowStorage);
+      if(validate)
+	printf("largest even-odd deviation from dense derivative: %e\n",wave.validationDeviation());
     }
   else
     {
-      auto wave = collTransmittingMultiWave(orders,abscissas,weights,DMats,doms,boundDatadx,isReflecting,verb);
-      odeEvolve(x,wave,duration,step,waveHist);
+      auto wave = collTransmittingMultiWave(bases,boundDatadx,isReflecting,verb);
+      wave.engine = engine;
+      wave.setThreads(threads);
+      wave.setValidation(validate);
+      odeEvolve(x,wave,duration,step,waveHist,lowStorage);
+      if(validate)
+	printf("largest even-odd deviation from dense derivative: %e\n",wave.validationDeviation());
     }
   
   if(verb) printf("Computing legendre modes (summing quadratures)...\n");
@@ -219,6 +298,10 @@ int main(int argv, char * args[])
   
   if(!vis)
       return 0;
+
+  // transform the plotted histories in one product per domain rather than per snapshot
+  for(int d=0;d<doms;d++)
+    states[d].functionStates[0].computeSpectralData(std::thread::hardware_concurrency());
   
   // plot the movie of the wavefunction
   std::vector<std::vector<scalarFunction>> plotAccumulator;
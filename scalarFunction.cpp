@@ -6,31 +6,56 @@ double scalarFunction::at(int i){
   return collocationData[i];}
 
 double scalarFunction::dx(int i){
-  return ((*DMat)*collocationData)[i];}
+  return dx()[i];}
 
 double scalarFunction::ddx(int i){
-  return ((*DMat)*(*DMat)*collocationData)[i];}
+  return ddx()[i];}
+
+const std::vector<double>& scalarFunction::dx(){
+  if(dxData == NULL)
+    {
+      dxData = std::shared_ptr<std::vector<double>>(new std::vector<double>((size_t)n));
+      // an operator that is not centro-antisymmetric has no exact even-odd form
+      if(evenOddDMat && evenOddDMat->valid)
+	evenOddDMat->apply(collocationData.data(),dxData->data());
+      else
+	DMat->apply(collocationData.data(),dxData->data());
+    }
+  return *dxData;}
+
+const std::vector<double>& scalarFunction::ddx(){
+  if(ddxData == NULL)
+    {
+      ddxData = std::shared_ptr<std::vector<double>>(new std::vector<double>((size_t)n));
+      basis->derivativeMatrix(2)->apply(collocationData.data(),ddxData->data());
+    }
+  return *ddxData;}
 
 
 double scalarFunction::at(double x){
   if(spectralData == NULL)
     quadSum();
-  double val=0;
-  for(int i=0;i<n;i++)
-      val+= spectralData->at(i)* boost::math::legendre_p(i,x);
-  return val;}
+  return legendreTools::clenshaw(spectralData->data(),n,x);}
 
 
 double scalarFunction::dx(double x){
   if(spectralData == NULL)
     quadSum();
-  double val=0;
-  for(int i=0;i<n;i++)
-    val+= spectralData->at(i)*legendreTools::legendreDeriv(i,x);
-  return val;
+  double f,df,ddf;
+  legendreTools::clenshaw(spectralData->data(),n,x,f,df,ddf);
+  return df;
+}
+
+void scalarFunction::evaluate(const double* xs, double* out, size_t m, int derivative){
+  if(spectralData == NULL)
+    quadSum();
+  legendreTools::clenshawBatch(spectralData->data(),n,xs,out,m,derivative);
 }
 
 double scalarFunction::at(double x,std::shared_ptr<std::vector<double>> baryWeights){
+  for(int i=0;i<n;i++)
+    if(x == abscissas->at(i))
+      return collocationData[i];
   double den = 0;
   double num = 0;
   double prod;
@@ -47,9 +72,12 @@ double scalarFunction::at(double x,std::shared_ptr<std::vector<double>> baryWeig
 
 
 double scalarFunction::dx(double x,std::shared_ptr<std::vector<double>> baryWeights){
+  for(int i=0;i<n;i++)
+    if(x == abscissas->at(i))
+      return dx(i);
   double den = 0;
   double num = 0;
-  double pointval = at(x);
+  double pointval = at(x,baryWeights);
   double prod;
   for(int i=0;i<n;i++)
     {
@@ -66,10 +94,9 @@ double scalarFunction::ddx(double x)
 {
   if(spectralData == NULL)
     quadSum();
-  double val=0;
-  for(int i=0;i<n;i++)
-    val+= spectralData->at(i)*legendreTools::legendreDDeriv(i,x);
-  return val;
+  double f,df,ddf;
+  legendreTools::clenshaw(spectralData->data(),n,x,f,df,ddf);
+  return ddf;
 }
 
 
@@ -77,13 +104,8 @@ void scalarFunction::quadSum()
 {
   if(spectralData == NULL)
     spectralData = std::shared_ptr<std::vector<double>>(new std::vector<double>((size_t)n));
-  
-  for(int i=0;i<n;i++)
-    {
-      double legi = 0;
-      for(int j=0;j<n;j++)
-	  legi+=weights->at(j)*collocationData[j]*boost::math::legendre_p(i,abscissas->at(j));
-      spectralData->at(i) = legi*(2*i + 1)/2;
-    }
+
+  // the weights and (2i+1)/2 normalisation are folded into the basis' transforms
+  basis->toModal(collocationData.data(),spectralData->data());
   return;
 }
@@ -1,9 +1,9 @@
 #include <vector>
 #include <memory>
 #include "math.h"
-#include <boost/math/special_functions/legendre.hpp>
 #include "legendreTools.hpp"
 #include "matrix.hpp"
+#include "spectralBasis.hpp"
 
 #ifndef SCALARFUNCTION
 #define SCALARFUNCTION
@@ -14,6 +14,11 @@
 /// domain. It stores the collocation data, and has utilities to generate
 /// spectral coefficients as well as compute the function value, first, and
 /// second derivatives at collocation points and off.
+///
+/// Derived quantities (spectral coefficients, derivatives at the collocation
+/// points) are computed lazily and cached. Change the data through
+/// setCollocationData(), or call invalidate() after writing collocationData
+/// directly, so the caches are discarded.
 class scalarFunction
 {
 public:
@@ -21,7 +26,11 @@ public:
   std::shared_ptr<std::vector<double>> abscissas; ///< a pointer to the abscissas of order n
   std::shared_ptr<std::vector<double>> weights; ///< a pointer to the weights of order n
   std::shared_ptr<matrix<double>> DMat; ///< a pointer to the derivative matrix for the abscissas used
+  std::shared_ptr<evenOddMatrix<double>> evenOddDMat; ///< optional even-odd form of DMat; when set and valid, dx() uses it
   std::shared_ptr<std::vector<double>> spectralData; ///< The spectral coefficients for the function. Lazily populated, often null 
+  std::shared_ptr<std::vector<double>> dxData; ///< first derivatives at the collocation points. Lazily populated, often null
+  std::shared_ptr<std::vector<double>> ddxData; ///< second derivatives at the collocation points. Lazily populated, often null
+  std::shared_ptr<spectralBasis> basis; ///< the basis data shared by all functions of this order
   int n; ///< The legendre order of the function
 
 
@@ -31,14 +40,16 @@ public:
   /// are stored as little as possible
   /// \param order order of the Legendre expansion, should match length of
   /// abscissas, weights, derivative matrix
+  /// \param inFamily family of the collocation points in the tables
   /// \param inAbscissas a shared pointer to the vector of abscissas
   /// \param inWeights a shared pointer to the vector of quadrature weights (not
   /// interpolation weights)
   /// \param inDMat a shared pointer to a the derivative matrix associated with
   /// the also provided abscissas
-  scalarFunction(int order, std::shared_ptr<std::vector<double>> inAbscissas, std::shared_ptr<std::vector<double>> inWeights,
-		 std::shared_ptr<matrix<double>> inDMat)
-    : n(order), abscissas(inAbscissas), weights(inWeights), DMat(inDMat), spectralData(NULL) {}
+  scalarFunction(int order, nodeFamily inFamily, std::shared_ptr<std::vector<double>> inAbscissas,
+		 std::shared_ptr<std::vector<double>> inWeights, std::shared_ptr<matrix<double>> inDMat)
+    : n(order), abscissas(inAbscissas), weights(inWeights), DMat(inDMat), spectralData(NULL),
+      basis(spectralBasis::wrap(order,inFamily,inAbscissas,inWeights,inDMat)) {}
 
   /// Scalar function constructor. This takes as arguments the order of the
   /// function, the abscissas, the weights, and the derivative matrix
@@ -46,15 +57,40 @@ public:
   /// duplicates are stored as little as possible. 
   /// \param order order of the Legendre expansion, should match length of
   /// abscissas, weights, derivative matrix
+  /// \param inFamily family of the collocation points in the tables
   /// \param inAbscissas a shared pointer to the vector of abscissas
   /// \param inWeights a shared pointer to the vector of quadrature weights (not
   /// interpolation weights)
   /// \param inDMat a shared pointer to a the derivative matrix associated with
   /// the also provided abscissas
   /// \param inCollocationData a vector of input collocation data to initialize
-  scalarFunction(int order, std::shared_ptr<std::vector<double>> inAbscissas, std::shared_ptr<std::vector<double>> inWeights,
-		 std::shared_ptr<matrix<double>> inDMat,std::vector<double> inCollocationData)
-    : n(order), abscissas(inAbscissas), weights(inWeights), DMat(inDMat), spectralData(NULL), collocationData(inCollocationData) {}
+  scalarFunction(int order, nodeFamily inFamily, std::shared_ptr<std::vector<double>> inAbscissas,
+		 std::shared_ptr<std::vector<double>> inWeights, std::shared_ptr<matrix<double>> inDMat,
+		 std::vector<double> inCollocationData)
+    : n(order), abscissas(inAbscissas), weights(inWeights), DMat(inDMat), spectralData(NULL), collocationData(inCollocationData),
+      basis(spectralBasis::wrap(order,inFamily,inAbscissas,inWeights,inDMat)) {}
+
+  /// Scalar function constructor on a shared basis, so that operators the
+  /// basis caches (such as higher derivative matrices) are built once for all
+  /// functions using it.
+  /// \param inBasis a shared pointer to the basis data
+  /// \param inCollocationData a vector of input collocation data to initialize
+  scalarFunction(std::shared_ptr<spectralBasis> inBasis, std::vector<double> inCollocationData)
+    : n(inBasis->n), abscissas(inBasis->abscissas), weights(inBasis->weights), DMat(inBasis->DMat), spectralData(NULL),
+      collocationData(inCollocationData), basis(inBasis) {}
+
+  /// Replaces the collocation data and discards every cached derived quantity
+  /// \param inCollocationData the new collocation values, length n
+  void setCollocationData(const std::vector<double> &inCollocationData){
+    collocationData = inCollocationData;
+    invalidate();}
+
+  /// Discards the cached spectral coefficients and derivatives; must be called
+  /// after collocationData is modified directly
+  void invalidate(){
+    spectralData = NULL;
+    dxData = NULL;
+    ddxData = NULL;}
 
   
   /// Evaluates the scalar function at a collocation point
@@ -62,60 +98,83 @@ public:
   /// \return the value of the function at the point \f$f(x^n_i)\f$
   double at(int i);
 
-  /// Evaluates the value of the scalar function at a collocation point. Uses
-  /// closed-form Legendre function, so can have noise at +/-1.0 abscissas, and
-  /// causes quadSum() to be run.
+  /// Evaluates the value of the scalar function at a point by Clenshaw
+  /// summation of its Legendre series. Causes quadSum() to be run.
   /// \param x the value of the point to be evaluated
   /// \return the value of the function at the point \f$f(x^n_i)\f$
   double at(double x);
+
+  /// Evaluates the scalar function, or one of its first two derivatives, at
+  /// many points by batched Clenshaw summation of its Legendre series, which
+  /// vectorizes across the points. Causes quadSum() to be run.
+  /// \param xs pointer to the points to be evaluated
+  /// \param out pointer to the values, populated as return parameter
+  /// \param m number of points
+  /// \param derivative 0 for values, 1 or 2 for first or second derivatives
+  void evaluate(const double* xs, double* out, size_t m, int derivative = 0);
   
   /// Evaluates the scalar function at an arbitrary point using interpolation
-  /// according to barycentric weights
+  /// according to barycentric weights, exactly at the collocation points. For
+  /// repeated evaluation at a fixed set of points, use an interpolationPlan.
   /// \param x the value of the point to be evaluated
   /// \param baryWeights a pointer to the vector of barycentric weights for interpolation
   /// \return the value of the function at the point \f$f(x)\f$
   double at(double x,std::shared_ptr<std::vector<double>> baryWeights);
 
   /// Evaluates the first derivative of the scalar function at a collocation
-  /// point
+  /// point, read from the cached derivative vector
   /// \param i the integer index of the collocation point to evaluate
   /// \return the value of the first derivative of the function at the point
   /// \f$f^\prime(x^n_i)\f$
+  /// \sa dx()
   double dx(int i);
 
-  /// Evaluates the first derivative of the scalar function at a collocation
-  /// point. Uses closed-form Legendre function, so can have noise at +/-1.0
-  /// abscissas, and causes quadSum() to be run.
+  /// Evaluates the first derivative of the scalar function at every
+  /// collocation point in a single pass, caching the result
+  /// \return the vector \f$f^\prime(x^n_i)\f$, valid until the data changes
+  const std::vector<double>& dx();
+
+  /// Evaluates the first derivative of the scalar function at a point by
+  /// Clenshaw summation of its Legendre series. Causes quadSum() to be run.
   /// \param x the value of the point to be evaluated
   /// \return the value of the first derivative of the function at the point
   /// \f$f^\prime(x^n_i)\f$
   double dx(double x);
 
   /// Evaluates the first derivative of the scalar function at an arbitrary
-  /// point using interpolation according to barycentric weights
+  /// point using interpolation according to barycentric weights, reading the
+  /// cached derivatives at the collocation points
   /// \param x the value of the point to be evaluated
   /// \param baryWeights a pointer to the vector of barycentric weights for interpolation
   /// \return the value of the first derivative of the function at the point \f$f^\prime(x)\f$  
   double dx(double x,std::shared_ptr<std::vector<double>> baryWeights);
 
   /// Evaluates the second derivative of the scalar function at a collocation
-  /// point
+  /// point, read from the cached second derivative vector
   /// \param i the integer index of the collocation point to evaluate
   /// \return the value of the second derivative of the function at the point
   /// \f$f^{\prime \prime}(x^n_i)\f$  
+  /// \sa ddx()
   double ddx(int i);
 
-  /// Evaluates the second derivative of the scalar function at a collocation
-  /// point. Uses closed-form Legendre function, so can have noise at +/-1.0
-  /// abscissas, and causes quadSum() to be run.
+  /// Evaluates the second derivative of the scalar function at every
+  /// collocation point in a single pass with the basis' cached \f$D^2\f$,
+  /// caching the result
+  /// \return the vector \f$f^{\prime \prime}(x^n_i)\f$, valid until the data changes
+  const std::vector<double>& ddx();
+
+  /// Evaluates the second derivative of the scalar function at a point by
+  /// Clenshaw summation of its Legendre series. Causes quadSum() to be run.
   /// \param x the value of the point to be evaluated
   /// \return the value of the second derivative of the function at the point
   /// \f$f^{\prime \prime}(x^n_i)\f$  
   double ddx(double x);
 
   /// Performs the quadrature sum to populate the spectralData using the
-  /// abscissas, weights, and collocationData. Called by functions which
-  /// evaluate the function at arbitrary points.
+  /// abscissas, weights, and collocationData, with the basis' nodal-to-modal
+  /// transform: a single cached product, or the fast Legendre transform
+  /// above the basis' crossover order. Called by functions which evaluate the
+  /// function at arbitrary points.
   void quadSum();
 
 };
@@ -1,6 +1,8 @@
 #include <stdio.h>
+#include <map>
 #include <boost/tuple/tuple.hpp>
 #include "scalarFunction.hpp"
+#include "interpolationPlan.hpp"
 #include "gnuplot-iostream.h"
 
 #define PLOTRES 300
@@ -12,6 +14,19 @@ namespace scalarPlots{
 
   Gnuplot gp;///< the global gnuplot variable for piping gnuplot commands to.
 
+  /// The interpolation plan from a basis to a set of plot points, built for
+  /// the first frame and reused by every later one
+  /// \param basis the basis of the plotted function
+  /// \param xs the plot points
+  /// \return the plan
+  const interpolationPlan &plotPlan(std::shared_ptr<spectralBasis> basis, const std::vector<double> &xs)
+  {
+    static std::map<std::pair<std::shared_ptr<spectralBasis>,std::vector<double>>,std::shared_ptr<interpolationPlan>> plans;
+    std::shared_ptr<interpolationPlan> &plan = plans[std::make_pair(basis,xs)];
+    if(!plan)
+      plan = std::shared_ptr<interpolationPlan>(new interpolationPlan(basis,xs));
+    return *plan;
+  }
 
   /// plots the values and first derivatives of a scalarFunction from -1 to 1 using
   /// gnuplot-iostream. Assumes single domain. Prepares stream for replotting.
@@ -24,10 +39,17 @@ namespace scalarPlots{
     double plotMin = -1;
     double plotMax = 1;
 
+    std::vector<double> xs;
     for(double val= plotMin;val<plotMax;val+=(plotMax-plotMin)/PLOTRES)
+      xs.push_back(val);
+    std::vector<double> ys(xs.size()),dys(xs.size());
+    const interpolationPlan &plan = plotPlan(vals.basis,xs);
+    plan.apply(vals,ys.data());
+    plan.apply(vals,dys.data(),1);
+    for(size_t i=0;i<xs.size();i++)
       {
-	pts.push_back(boost::make_tuple(val,vals.at(val)));
-	derivs.push_back(boost::make_tuple(val,vals.dx(val)));
+	pts.push_back(boost::make_tuple(xs[i],ys[i]));
+	derivs.push_back(boost::make_tuple(xs[i],dys[i]));
       }
     gp << "set term x11 1 noraise\n";
     gp<< "set xrange[-1:1]\nset yrange[-5:5]\n";
@@ -49,10 +71,25 @@ namespace scalarPlots{
     double plotMin = -1;
     double plotMax = -1 + 2.0*vals.size();
 
+    // gather each domain's plot points in local coordinates and evaluate them with one product
+    std::vector<std::vector<double>> plotX(vals.size()),localX(vals.size());
     for(double val= plotMin;val<plotMax;val+=(plotMax-plotMin)/PLOTRES)
       {
-	pts.push_back(boost::make_tuple(val,vals[(int)((val+1)/2.0)].at((double)(val - 2.0 * (int)((val + 1)/2.0)) )));
-	derivs.push_back(boost::make_tuple(val,vals[(int)((val+1)/2.0)].dx((double)(val - 2.0 * (int)((val + 1)/2.0)) )));
+	int d = (int)((val+1)/2.0);
+	plotX[d].push_back(val);
+	localX[d].push_back((double)(val - 2.0 * d));
+      }
+    for(size_t d=0;d<vals.size();d++)
+      {
+	std::vector<double> ys(localX[d].size()),dys(localX[d].size());
+	const interpolationPlan &plan = plotPlan(vals[d].basis,localX[d]);
+	plan.apply(vals[d],ys.data());
+	plan.apply(vals[d],dys.data(),1);
+	for(size_t i=0;i<localX[d].size();i++)
+	  {
+	    pts.push_back(boost::make_tuple(plotX[d][i],ys[i]));
+	    derivs.push_back(boost::make_tuple(plotX[d][i],dys[i]));
+	  }
       }
     gp << "set term x11 1 noraise\n";
     gp<< "set xrange[-1:"<<plotMax<<"]\nset yrange[-5:5]\n";
@@ -77,19 +114,17 @@ namespace scalarPlots{
     double plotMin = 0;
     double plotMax = maxtime;
 
+    modes.resize(doms*n);
     for(int d=0;d<doms;d++)
-      {
-	for(int i=0;i<n;i++)
-	  {
-	    modes.push_back(std::vector<boost::tuple<double,double>>());
-	    for(int j=0;j<vals.size()-timesteps+1;j+=timesteps)
-	      {
-		vals[j].at(d).quadSum();
-		modes[d*n+i].push_back(boost::make_tuple(maxtime*(double)j/(double)vals.size(),
-							 vals[j].at(d).spectralData->at(vals[j].at(d).spectralData->size()-1-i)));
-	      }
-	  }
-      }
+      for(int j=0;j<vals.size()-timesteps+1;j+=timesteps)
+	{
+	  // one transform per snapshot serves every plotted mode
+	  if(vals[j].at(d).spectralData == NULL)
+	    vals[j].at(d).quadSum();
+	  for(int i=0;i<n;i++)
+	    modes[d*n+i].push_back(boost::make_tuple(maxtime*(double)j/(double)vals.size(),
+						     vals[j].at(d).spectralData->at(vals[j].at(d).spectralData->size()-1-i)));
+	}
     gp<< "set xrange[0:"<<maxtime<<"]\nset yrange[-10:10]\n";
     gp<<"plot ";
     for(int d=0;d<doms;d++)
@@ -121,19 +156,17 @@ namespace scalarPlots{
     double plotMin = 0;
     double plotMax = maxtime;
 
+    modes.resize(doms*n);
     for(int d=0;d<doms;d++)
-      {
-	for(int i=0;i<n;i++)
-	  {
-	    modes.push_back(std::vector<boost::tuple<double,double>>());
-	    for(int j=0;j<vals.size();j+=timesteps)
-	      {
-		vals[j].at(d).quadSum();
-		modes[d*n+i].push_back(boost::make_tuple(maxtime*(double)j/(double)vals.size(),
-							 vals[j].at(d).spectralData->at(i)));
-	      }
-	  }
-      }
+      for(int j=0;j<vals.size();j+=timesteps)
+	{
+	  // one transform per snapshot serves every plotted mode
+	  if(vals[j].at(d).spectralData == NULL)
+	    vals[j].at(d).quadSum();
+	  for(int i=0;i<n;i++)
+	    modes[d*n+i].push_back(boost::make_tuple(maxtime*(double)j/(double)vals.size(),
+						     vals[j].at(d).spectralData->at(i)));
+	}
     gp<< "set xrange[0:"<<maxtime<<"]\nset yrange[-10:10]\n";
     gp<<"plot ";
     for(int d=0;d<doms;d++)
@@ -164,14 +197,13 @@ namespace scalarPlots{
     double plotMin = 0;
     double plotMax = maxtime;
 
-    for(int i = 0; i<n;i++)
+    modes.resize(n);
+    for(int j=0;j<vals.size();j+=timesteps)
       {
-	modes.push_back(std::vector<boost::tuple<double,double>>());
-	for(int j=0;j<vals.size();j+=timesteps)
-	  {
-	    vals.at(j).quadSum();
-	    modes[i].push_back(boost::make_tuple(j,vals.at(j).spectralData->at(i)));
-	  }
+	if(vals.at(j).spectralData == NULL)
+	  vals.at(j).quadSum();
+	for(int i = 0; i<n;i++)
+	  modes[i].push_back(boost::make_tuple(j,vals.at(j).spectralData->at(i)));
       }
     gp<< "set xrange[0:"<<maxtime<<"]\nset yrange[-10:10]\n";
     gp<<"plot ";
@@ -193,8 +225,13 @@ namespace scalarPlots{
     double plotMin = -1;
     double plotMax = 1;
 
+    std::vector<double> xs;
     for(double val= plotMin;val<plotMax;val+=(plotMax-plotMin)/PLOTRES)
-      pts.push_back(boost::make_tuple(val,vals.at(val)));
+      xs.push_back(val);
+    std::vector<double> ys(xs.size());
+    plotPlan(vals.basis,xs).apply(vals,ys.data());
+    for(size_t i=0;i<xs.size();i++)
+      pts.push_back(boost::make_tuple(xs[i],ys[i]));
     gp<< "set xrange[-1:1]\nset yrange[-5:5]\n";
     gp<< "plot '-' with lines title 'simpleWave'\n";
     gp.send1d(pts);
@@ -211,8 +248,13 @@ namespace scalarPlots{
     double plotMin = -1;
     double plotMax = 1;
 
+    std::vector<double> xs;
     for(double val= plotMin;val<plotMax;val+=(plotMax-plotMin)/PLOTRES)
-      pts.push_back(boost::make_tuple(val,vals.dx(val)));
+      xs.push_back(val);
+    std::vector<double> dys(xs.size());
+    plotPlan(vals.basis,xs).apply(vals,dys.data(),1);
+    for(size_t i=0;i<xs.size();i++)
+      pts.push_back(boost::make_tuple(xs[i],dys[i]));
     gp<< "set xrange[-1:1]\nset yrange[-5:5]\n";
     gp<< "plot '-' with lines title 'simpleWave'\n";
     gp.send1d(pts);
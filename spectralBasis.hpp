@@ -0,0 +1,469 @@
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <tuple>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+#include "legendreTools.hpp"
+#include "fastLegendre.hpp"
+#include "chebyshevTools.hpp"
+#include "basisCache.hpp"
+#include "matrix.hpp"
+
+#ifndef SPECTRALBASIS_H
+#define SPECTRALBASIS_H
+
+// lowest order using the fast Legendre transform when no calibration file is
+// installed; `run_bench --calibrate-flt` measures it for the build machine
+#ifndef FAST_TRANSFORM_ORDER
+#define FAST_TRANSFORM_ORDER 2048
+#endif
+#ifndef SCALARTOY_CALIBRATION_FILE
+#define SCALARTOY_CALIBRATION_FILE ""
+#endif
+
+/// The families of collocation points a basis can be built on
+enum nodeFamily
+{
+  gaussNodes, ///< Gauss-Legendre points, the zeros of \f$P_n\f$
+  gaussLobattoNodes, ///< Gauss-Lobatto points, including the endpoints +/-1
+  chebyshevLobattoNodes ///< Chebyshev-Gauss-Lobatto points \f$-\cos(\pi i/(n-1))\f$, with Clenshaw-Curtis weights
+};
+
+
+/// Per-order spectral basis data
+
+/// Holds the data shared by every function expanded on the same set of
+/// collocation points: the abscissas, quadrature and barycentric weights,
+/// derivative matrix and boundary interpolants, along with operators derived
+/// from them (higher derivative matrices, Vandermonde transforms), which are
+/// built on first use and then cached for all functions sharing the basis.
+///
+/// Bases obtained through get() are built once per (order, node family) for
+/// the whole process and shared by reference, so domains of equal order hold
+/// no private copies of any of this data.
+class spectralBasis
+{
+public:
+  int n; ///< number of collocation points
+  nodeFamily family; ///< the node family of the abscissas
+  std::shared_ptr<std::vector<double>> abscissas; ///< the collocation points
+  std::shared_ptr<std::vector<double>> weights; ///< the quadrature weights
+  std::shared_ptr<std::vector<double>> baryWeights; ///< the barycentric interpolation weights
+  std::shared_ptr<matrix<double>> DMat; ///< the first derivative matrix
+  std::shared_ptr<std::vector<double>> leftInterpolant; ///< weights interpolating the collocation data to -1
+  std::shared_ptr<std::vector<double>> rightInterpolant; ///< weights interpolating the collocation data to 1
+  bool fastModal = (family != chebyshevLobattoNodes && n >= fastTransformOrder()); ///< whether toModal() uses the fast Legendre transform
+
+  /// Generates a basis of the given order and node family. Prefer get(), which
+  /// shares one instance per (order, family) across the process.
+  /// \param order number of collocation points
+  /// \param inFamily family of collocation points
+  spectralBasis(int order, nodeFamily inFamily)
+    : n(order), family(inFamily)
+  {
+    if(family == chebyshevLobattoNodes)
+      {
+	abscissas = chebyshevTools::generateAbscissas(order);
+	weights = chebyshevTools::generateWeights(order);
+	baryWeights = chebyshevTools::generateBaryWeights(order);
+	DMat = legendreTools::generateDMat(order,abscissas,baryWeights);
+	generateInterpolants();
+	return;
+      }
+    const bool lobatto = (family == gaussLobattoNodes);
+    std::tie(abscissas,weights) = legendreTools::generateQuadrature(order,lobatto);
+    // the product formula for the barycentric weights under/overflows at high orders
+    baryWeights = (order >= legendreTools::GLR_ORDER) ? legendreTools::generateBaryWeights(order,abscissas,weights,lobatto)
+      : legendreTools::generateBaryWeights(order,abscissas);
+    DMat = legendreTools::generateDMat(order,abscissas,baryWeights);
+    generateInterpolants();
+  }
+
+  /// basis constructor, sharing already generated data; the barycentric
+  /// weights and boundary interpolants are derived from the abscissas and
+  /// weights of the given family. Prefer wrap(), which shares one instance
+  /// per set of tables.
+  /// \param order number of collocation points
+  /// \param inFamily family of the collocation points in the tables
+  /// \param inAbscissas a shared pointer to the vector of abscissas
+  /// \param inWeights a shared pointer to the vector of quadrature weights
+  /// \param inDMat a shared pointer to the derivative matrix for the abscissas
+  spectralBasis(int order, nodeFamily inFamily, std::shared_ptr<std::vector<double>> inAbscissas,
+		std::shared_ptr<std::vector<double>> inWeights, std::shared_ptr<matrix<double>> inDMat)
+    : n(order), family(inFamily), abscissas(inAbscissas), weights(inWeights), DMat(inDMat)
+  {
+    baryWeights = (family == chebyshevLobattoNodes) ? chebyshevTools::generateBaryWeights(order)
+      : legendreTools::generateBaryWeights(order,abscissas,weights,family == gaussLobattoNodes);
+    generateInterpolants();
+  }
+
+  /// basis constructor from tables loaded out of the on-disk cache
+  /// \param order number of collocation points
+  /// \param inFamily family of collocation points
+  /// \param cached the abscissas, weights, barycentric weights and derivative matrix
+  spectralBasis(int order, nodeFamily inFamily, const basisCache::tables &cached)
+    : n(order), family(inFamily), abscissas(cached.abscissas), weights(cached.weights),
+      baryWeights(cached.baryWeights), DMat(cached.DMat)
+  {
+    generateInterpolants();
+  }
+
+  /// The lowest order whose bases use the fast Legendre transform for
+  /// toModal() by default. Read from the calibration file installed by
+  /// `run_bench --calibrate-flt`, falling back to a compiled-in default.
+  /// \return the crossover order
+  static int fastTransformOrder()
+  {
+    return crossoverOrder();
+  }
+
+  /// Overrides the crossover order of fastTransformOrder() for bases
+  /// constructed afterwards; a single basis can instead set its fastModal flag.
+  /// \param order the lowest order using the fast transform
+  static void setFastTransformOrder(int order)
+  {
+    crossoverOrder() = order;
+  }
+
+  /// Sets the directory of the on-disk basis cache used by get(). When set,
+  /// bases are loaded from the cache if present and written to it after
+  /// being generated otherwise. Set before the first call to get().
+  /// \param dir the cache directory, or an empty string to disable the cache
+  static void setCacheDirectory(const std::string &dir)
+  {
+    cacheDirectory() = dir;
+  }
+
+  /// The process-wide basis for an order and node family, generated on the
+  /// first request and shared by every later one. Safe to call from several
+  /// threads; concurrent requests for the same basis build it exactly once,
+  /// while different bases may be built concurrently. With a cache directory
+  /// set, the tables come from the on-disk cache when it holds a valid entry.
+  /// \param order number of collocation points
+  /// \param family family of collocation points
+  /// \return a shared pointer to the basis
+  static std::shared_ptr<spectralBasis> get(int order, nodeFamily family)
+  {
+    static std::mutex registryMutex;
+    static std::map<std::pair<int,nodeFamily>,std::shared_ptr<registryEntry>> registry;
+    std::shared_ptr<registryEntry> entry;
+    {
+      std::lock_guard<std::mutex> lock(registryMutex);
+      std::shared_ptr<registryEntry> &slot = registry[std::make_pair(order,family)];
+      if(!slot)
+	slot = std::shared_ptr<registryEntry>(new registryEntry());
+      entry = slot;
+    }
+    std::call_once(entry->built,[&](){
+	entry->basis = load(order,family);});
+    return entry->basis;
+  }
+
+  /// The basis wrapping separately generated tables, shared by every request
+  /// for the same tables for as long as one of them holds it, so functions
+  /// and domains built from the same data share one basis and the operators
+  /// it caches. Safe to call from several threads.
+  /// \param order number of collocation points
+  /// \param family family of the collocation points in the tables
+  /// \param inAbscissas a shared pointer to the vector of abscissas
+  /// \param inWeights a shared pointer to the vector of quadrature weights
+  /// \param inDMat a shared pointer to the derivative matrix for the abscissas
+  /// \return a shared pointer to the basis
+  static std::shared_ptr<spectralBasis> wrap(int order, nodeFamily family, std::shared_ptr<std::vector<double>> inAbscissas,
+					     std::shared_ptr<std::vector<double>> inWeights, std::shared_ptr<matrix<double>> inDMat)
+  {
+    typedef std::tuple<int,nodeFamily,const void*,const void*,const void*> tableKey;
+    static std::mutex wrappedMutex;
+    static std::map<tableKey,std::weak_ptr<spectralBasis>> wrapped;
+    // the basis holds the tables, so their addresses are not reused while its entry is live
+    const tableKey key(order,family,inAbscissas.get(),inWeights.get(),inDMat.get());
+    std::lock_guard<std::mutex> lock(wrappedMutex);
+    std::shared_ptr<spectralBasis> basis = wrapped[key].lock();
+    if(basis)
+      return basis;
+    for(auto it=wrapped.begin();it!=wrapped.end();)
+      it = it->second.expired() ? wrapped.erase(it) : std::next(it);
+    basis = std::shared_ptr<spectralBasis>(new spectralBasis(order,family,inAbscissas,inWeights,inDMat));
+    wrapped[key] = basis;
+    return basis;
+  }
+
+  /// Loads a basis from the on-disk cache, or generates it and stores it there
+  /// when the cache holds no valid entry. Without a cache directory this just
+  /// generates the basis.
+  /// \param order number of collocation points
+  /// \param family family of collocation points
+  /// \return a shared pointer to the basis
+  static std::shared_ptr<spectralBasis> load(int order, nodeFamily family)
+  {
+    const std::string &dir = cacheDirectory();
+    basisCache::tables cached;
+    if(!dir.empty() && basisCache::load(dir,order,family,cached))
+      return std::shared_ptr<spectralBasis>(new spectralBasis(order,family,cached));
+    std::shared_ptr<spectralBasis> basis(new spectralBasis(order,family));
+    if(!dir.empty())
+      {
+	cached.abscissas = basis->abscissas;
+	cached.weights = basis->weights;
+	cached.baryWeights = basis->baryWeights;
+	cached.DMat = basis->DMat;
+	if(!basisCache::store(dir,order,family,cached))
+	  printf("could not write basis of order %d to cache %s\n",order,dir.c_str());
+      }
+    return basis;
+  }
+
+  /// The matrix of the k-th derivative at the collocation points, \f$D^k\f$.
+  /// Built on first request and cached; safe to call from several threads.
+  /// \param k derivative order, at least 1
+  /// \return a shared pointer to \f$D^k\f$
+  std::shared_ptr<const matrix<double>> derivativeMatrix(int k)
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(powers.empty())
+      powers.push_back(DMat);
+    while((int)powers.size() < k)
+      powers.push_back(std::shared_ptr<matrix<double>>(new matrix<double>((*DMat)*(*powers.back()))));
+    return powers[k-1];
+  }
+
+  /// The Vandermonde matrix \f$V_{j i} = P_i(x_j)\f$, which maps Legendre
+  /// coefficients to collocation values (modal to nodal). Built on first
+  /// request and cached.
+  /// \return a shared pointer to V
+  std::shared_ptr<const matrix<double>> vandermonde()
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(!inverseTransform)
+      {
+	inverseTransform = std::shared_ptr<matrix<double>>(new matrix<double>(n));
+	std::vector<double> P((size_t)n*n);
+	legendreTools::legendreAllBatch(n-1,abscissas->data(),n,P.data());
+	for(int j=0;j<n;j++)
+	  for(int i=0;i<n;i++)
+	    (*inverseTransform)[j][i] = P[(size_t)i*n + j];
+      }
+    return inverseTransform;
+  }
+
+  /// The quadrature transform from collocation values to Legendre
+  /// coefficients (nodal to modal), \f$F_{i j} = \frac{2i+1}{2} w_j
+  /// P_i(x_j)\f$, with the weights and normalization folded in. Built on first
+  /// request and cached.
+  /// \return a shared pointer to F
+  std::shared_ptr<const matrix<double>> forwardTransform()
+  {
+    if(family == chebyshevLobattoNodes)
+      {
+	// Clenshaw-Curtis quadrature is not exact for these products, so the
+	// columns are the exact transforms of the unit vectors instead
+	std::shared_ptr<const chebyshevTools::transform> T = chebyshevTransform();
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	if(!nodalToModal)
+	  {
+	    nodalToModal = std::shared_ptr<matrix<double>>(new matrix<double>(n));
+	    std::vector<double> unit(n,0.0),column(n);
+	    for(int j=0;j<n;j++)
+	      {
+		unit[j] = 1.0;
+		T->toLegendre(unit.data(),column.data());
+		unit[j] = 0.0;
+		for(int i=0;i<n;i++)
+		  (*nodalToModal)[i][j] = column[i];
+	      }
+	  }
+	return nodalToModal;
+      }
+    std::shared_ptr<const matrix<double>> V = vandermonde();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(!nodalToModal)
+      {
+	nodalToModal = std::shared_ptr<matrix<double>>(new matrix<double>(n));
+	for(int i=0;i<n;i++)
+	  for(int j=0;j<n;j++)
+	    (*nodalToModal)[i][j] = weights->at(j)*(*V)[j][i]*(2*i + 1)/2;
+      }
+    return nodalToModal;
+  }
+
+  /// The FFT-based transforms of a Chebyshev basis, for O(n log n)
+  /// differentiation and exact transforms to Legendre coefficients. Built on
+  /// first request and cached.
+  /// \return a shared pointer to the transforms, null for other node families
+  std::shared_ptr<const chebyshevTools::transform> chebyshevTransform()
+  {
+    if(family != chebyshevLobattoNodes)
+      return nullptr;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(!chebyshevTransforms)
+      chebyshevTransforms = std::shared_ptr<chebyshevTools::transform>(new chebyshevTools::transform(n));
+    return chebyshevTransforms;
+  }
+
+  /// The O(n log n) fast Legendre transform from collocation values to
+  /// Legendre coefficients. Built on first request and cached.
+  /// \return a shared pointer to the transform
+  std::shared_ptr<const fastLegendreTransform> fastTransform()
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(!fastNodalToModal)
+      fastNodalToModal = std::shared_ptr<fastLegendreTransform>(new fastLegendreTransform(n,*abscissas,*weights));
+    return fastNodalToModal;
+  }
+
+  /// Transforms one nodal vector to Legendre coefficients, with the fast
+  /// transform when fastModal is set, the exact Chebyshev transform on
+  /// Chebyshev bases, and the cached dense one otherwise
+  /// \param nodal pointer to the n collocation values
+  /// \param modal pointer to the n coefficients, populated as return parameter
+  void toModal(const double* nodal, double* modal)
+  {
+    if(family == chebyshevLobattoNodes)
+      chebyshevTransform()->toLegendre(nodal,modal);
+    else if(fastModal)
+      fastTransform()->forward(nodal,modal);
+    else
+      forwardTransform()->apply(nodal,modal);
+  }
+
+  /// Transforms a block of nodal vectors to Legendre coefficients in one
+  /// blocked matrix product with the cached forward transform, \f$S = X F^T\f$,
+  /// or row by row with the fast transforms when fastModal is set or on
+  /// Chebyshev bases.
+  /// Each row of the block is one vector of n collocation values, such as one
+  /// timestep of a history.
+  /// \param nodal pointer to the collocation values, count rows of n
+  /// \param ldNodal distance between rows of nodal
+  /// \param modal pointer to the coefficients, populated as return parameter
+  /// \param ldModal distance between rows of modal
+  /// \param count number of rows
+  /// \param threads number of threads to split the rows over
+  void toModal(const double* nodal, int ldNodal, double* modal, int ldModal, int count, int threads = 1)
+  {
+    // a row at a time with the fast transforms, which avoid building the dense one
+    const bool rowwise = fastModal || family == chebyshevLobattoNodes;
+    std::shared_ptr<const matrix<double>> FT;
+    if(!rowwise)
+      FT = forwardTransformTransposed();
+    auto block = [&](int first, int rows){
+      if(rowwise)
+	for(int r=first;r<first + rows;r++)
+	  toModal(nodal + (size_t)r*ldNodal,modal + (size_t)r*ldModal);
+      else
+	matrixKernels::gemm(rows,n,n,1.0,nodal + (size_t)first*ldNodal,ldNodal,FT->data(),FT->ld,
+			    0.0,modal + (size_t)first*ldModal,ldModal);};
+    // below a few rows per thread the product is too small to be worth
+    // splitting, while each fast transform is worth a thread of its own
+    threads = std::max(1,std::min(threads,rowwise ? count : count/16));
+    if(threads == 1)
+      {
+	block(0,count);
+	return;
+      }
+    std::vector<std::thread> pool;
+    const int chunk = (count + threads - 1)/threads;
+    for(int t=0;t<threads;t++)
+      {
+	const int first = t*chunk;
+	const int rows = std::min(chunk,count - first);
+	if(rows > 0)
+	  pool.push_back(std::thread(block,first,rows));
+      }
+    for(auto &thread : pool)
+      thread.join();
+  }
+
+  /// The transpose of forwardTransform(), the right factor of batched
+  /// nodal-to-modal products. Built on first request and cached.
+  /// \return a shared pointer to \f$F^T\f$
+  std::shared_ptr<const matrix<double>> forwardTransformTransposed()
+  {
+    std::shared_ptr<const matrix<double>> F = forwardTransform();
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if(!nodalToModalT)
+      {
+	nodalToModalT = std::shared_ptr<matrix<double>>(new matrix<double>(n));
+	for(int i=0;i<n;i++)
+	  for(int j=0;j<n;j++)
+	    (*nodalToModalT)[j][i] = (*F)[i][j];
+      }
+    return nodalToModalT;
+  }
+
+private:
+  /// a registry slot, built at most once
+  struct registryEntry
+  {
+    std::once_flag built; ///< flags that the basis has been generated
+    std::shared_ptr<spectralBasis> basis; ///< the generated basis
+  };
+
+  /// the on-disk cache directory, empty when caching is disabled
+  static std::string &cacheDirectory()
+  {
+    static std::string dir;
+    return dir;
+  }
+
+  /// the crossover order, read from the calibration file on first use
+  static int &crossoverOrder()
+  {
+    static int order = [](){
+      int calibrated = FAST_TRANSFORM_ORDER;
+      FILE* file = fopen(SCALARTOY_CALIBRATION_FILE,"r");
+      if(file)
+	{
+	  if(fscanf(file,"flt_order %d",&calibrated) != 1)
+	    calibrated = FAST_TRANSFORM_ORDER;
+	  fclose(file);
+	}
+      return calibrated;}();
+    return order;
+  }
+
+  std::mutex cacheMutex; ///< guards the lazily built operators
+  std::vector<std::shared_ptr<matrix<double>>> powers; ///< powers[k-1] holds D^k once built
+  std::shared_ptr<matrix<double>> inverseTransform; ///< the Vandermonde matrix, once built
+  std::shared_ptr<matrix<double>> nodalToModal; ///< the forward quadrature transform, once built
+  std::shared_ptr<matrix<double>> nodalToModalT; ///< the transposed forward transform, once built
+  std::shared_ptr<fastLegendreTransform> fastNodalToModal; ///< the fast forward transform, once built
+  std::shared_ptr<chebyshevTools::transform> chebyshevTransforms; ///< the Chebyshev FFT transforms, once built
+
+  /// generates the barycentric interpolation weights to the boundary points,
+  /// exact when a boundary point is itself a collocation point
+  void generateInterpolants()
+  {
+    leftInterpolant = std::shared_ptr<std::vector<double>>(new std::vector<double>(n,0.0));
+    rightInterpolant = std::shared_ptr<std::vector<double>>(new std::vector<double>(n,0.0));
+    interpolantTo(-1.0,*leftInterpolant);
+    interpolantTo(1.0,*rightInterpolant);
+  }
+
+  /// fills the barycentric interpolation weights to a single point
+  /// \param x the point to interpolate to
+  /// \param interp the weights, length n, populated as return parameter
+  void interpolantTo(double x, std::vector<double> &interp)
+  {
+    for(int i=0;i<n;i++)
+      if(abscissas->at(i) == x)
+	{
+	  interp[i] = 1.0;
+	  return;
+	}
+    double sum=0;
+    for(int i=0;i<n;i++)
+      {
+	interp[i] = baryWeights->at(i)/(x - abscissas->at(i));
+	sum+=interp[i];
+      }
+    for(int i=0;i<n;i++)
+      interp[i] = interp[i]/sum;
+  }
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "threadPool.hpp"
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+/// A fixed graph of dependent tasks, run repeatedly on a thread pool
+
+/// Tasks are numbered in the order they are added, and may only depend on
+/// earlier tasks, so the numbering is a topological order. Each run, every
+/// task's count of unfinished dependencies is reset, the tasks without any
+/// are put on a ready queue, and every thread of the pool takes tasks from
+/// the queue, pushing each successor whose last dependency it has just
+/// finished. A task therefore starts as soon as the tasks it reads from are
+/// done, rather than at a barrier after a whole phase. The ready queue is a
+/// lock-free array sized to the number of tasks, as each task is queued
+/// exactly once per run, and running the graph never allocates.
+class taskGraph
+{
+public:
+  /// the timing of one task in a traced run
+  struct record
+  {
+    int thread; ///< the thread that ran the task
+    double start; ///< seconds from the start of the run
+    double end; ///< seconds from the start of the run
+  };
+
+  /// adds a task
+  /// \param phase the phase of the task in the equivalent bulk-synchronous schedule
+  /// \return the index of the task
+  int add(int phase = 0)
+  {
+    phases.push_back(phase);
+    successors.push_back(std::vector<int>());
+    dependencies.push_back(std::vector<int>());
+    first.clear();
+    return phases.size() - 1;
+  }
+
+  /// makes a task wait for an earlier one
+  /// \param task the dependent task
+  /// \param on the task it waits for, which must have been added before it
+  void depend(int task, int on)
+  {
+    successors[on].push_back(task);
+    dependencies[task].push_back(on);
+    first.clear();
+  }
+
+  /// \return the number of tasks
+  int size() const{
+    return phases.size();}
+
+  /// Runs every task on the pool, returning once all are done
+  /// \param pool the threads to run on, or null to run on the calling thread
+  /// \param body callable taking the task index
+  /// \param trace if set, receives the timing of each task
+  template <typename F>
+  void run(threadPool* pool, F &body, std::vector<record>* trace = nullptr)
+  {
+    if(first.empty())
+      finalize();
+    const int count = size();
+    for(int t=0;t<count;t++)
+      {
+	state[t].remaining.store(indegree[t],std::memory_order_relaxed);
+	state[t].queued.store(-1,std::memory_order_relaxed);
+      }
+    head.store(0,std::memory_order_relaxed);
+    tail.store(0,std::memory_order_relaxed);
+    done.store(0,std::memory_order_relaxed);
+    for(int t=0;t<count;t++)
+      if(indegree[t] == 0)
+	push(t);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto seconds = [&](){
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();};
+    auto loop = [&](int thread){
+      for(;;)
+	{
+	  const int task = pop();
+	  if(task < 0)
+	    {
+	      if(done.load(std::memory_order_acquire) == count)
+		return;
+	      std::this_thread::yield();
+	      continue;
+	    }
+	  const double began = trace ? seconds() : 0;
+	  body(task);
+	  if(trace)
+	    (*trace)[task] = record{thread,began,seconds()};
+	  for(int s=first[task];s<first[task + 1];s++)
+	    if(state[links[s]].remaining.fetch_sub(1,std::memory_order_acq_rel) == 1)
+	      push(links[s]);
+	  done.fetch_add(1,std::memory_order_release);
+	}
+    };
+    if(trace)
+      trace->resize(count);
+    if(pool)
+      pool->runOnEach(loop);
+    else
+      loop(0);
+  }
+
+  /// The length of the longest chain of dependent tasks, with the task
+  /// durations of a traced run
+  /// \param trace the timing of each task
+  /// \return the critical path length in seconds
+  double criticalPath(const std::vector<record> &trace) const
+  {
+    std::vector<double> finish(size());
+    double longest = 0;
+    for(int t=0;t<size();t++)
+      {
+	double ready = 0;
+	for(int d : dependencies[t])
+	  ready = std::max(ready,finish[d]);
+	finish[t] = ready + trace[t].end - trace[t].start;
+	longest = std::max(longest,finish[t]);
+      }
+    return longest;
+  }
+
+  /// The critical path of the bulk-synchronous schedule of the same tasks,
+  /// where each phase starts only once the previous one has finished: the sum
+  /// over phases of the longest task in each
+  /// \param trace the timing of each task
+  /// \return the critical path length in seconds
+  double phasedCriticalPath(const std::vector<record> &trace) const
+  {
+    std::vector<double> longest;
+    for(int t=0;t<size();t++)
+      {
+	if(phases[t] >= (int)longest.size())
+	  longest.resize(phases[t] + 1,0.0);
+	longest[phases[t]] = std::max(longest[phases[t]],trace[t].end - trace[t].start);
+      }
+    double sum = 0;
+    for(double l : longest)
+      sum+=l;
+    return sum;
+  }
+
+private:
+  /// the per-run state of a task, alone on its cache line
+  struct alignas(64) taskState
+  {
+    std::atomic<int> remaining{0}; ///< dependencies yet to finish
+    std::atomic<int> queued{-1}; ///< the task in this slot of the ready queue, -1 until pushed
+  };
+
+  std::vector<int> phases; ///< the phase of each task
+  std::vector<std::vector<int>> successors; ///< the tasks waiting on each task
+  std::vector<std::vector<int>> dependencies; ///< the tasks each task waits on
+  std::vector<int> first; ///< offset into links of the successors of each task, empty until finalized
+  std::vector<int> links; ///< the successors of every task, packed
+  std::vector<int> indegree; ///< the number of dependencies of each task
+  std::unique_ptr<taskState[]> state; ///< per-task counters and ready queue slots
+  std::atomic<int> head{0}; ///< next ready queue slot to pop
+  std::atomic<int> tail{0}; ///< next ready queue slot to push
+  std::atomic<int> done{0}; ///< tasks finished in this run
+
+  /// packs the successor lists for the runs
+  void finalize()
+  {
+    const int count = size();
+    first.assign(count + 1,0);
+    links.clear();
+    indegree.clear();
+    for(int t=0;t<count;t++)
+      {
+	first[t] = links.size();
+	links.insert(links.end(),successors[t].begin(),successors[t].end());
+	indegree.push_back(dependencies[t].size());
+      }
+    first[count] = links.size();
+    state.reset(new taskState[std::max(count,1)]);
+  }
+
+  /// queues a task whose dependencies are all done
+  void push(int task)
+  {
+    const int slot = tail.fetch_add(1,std::memory_order_relaxed);
+    state[slot].queued.store(task,std::memory_order_release);
+  }
+
+  /// takes a ready task off the queue
+  /// \return the task, or -1 if none is ready
+  int pop()
+  {
+    int slot = head.load(std::memory_order_relaxed);
+    for(;;)
+      {
+	if(slot >= tail.load(std::memory_order_acquire))
+	  return -1;
+	if(head.compare_exchange_weak(slot,slot + 1,std::memory_order_relaxed))
+	  break;
+      }
+    // the slot was reserved by a push that may not have stored its task yet
+    int task;
+    while((task = state[slot].queued.load(std::memory_order_acquire)) < 0)
+      std::this_thread::yield();
+    return task;
+  }
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// number of polls a worker spins for the next loop before it sleeps, so that
+// back-to-back right-hand side evaluations do not pay a wake-up each
+#ifndef THREADPOOL_SPIN
+#define THREADPOOL_SPIN 20000
+#endif
+
+/// A persistent pool of threads for fork-join loops over weighted tasks
+
+/// The workers are started once and wait between loops, spinning briefly and
+/// then sleeping, so a loop costs no thread creation. Each loop is split
+/// into one contiguous range of tasks per thread, balanced by the task costs
+/// given to partition(); a thread that finishes its own range steals tasks
+/// from the back of the others' ranges. run() returns only once every task
+/// is done, so it doubles as the barrier between phases. The calling thread
+/// takes part as thread 0, and running a loop never allocates; thread-local
+/// scratch can be sized up front by an init function run on every thread.
+class threadPool
+{
+public:
+  /// starts the workers, returning once each has run init
+  /// \param threads total number of threads including the caller, at least 1
+  /// \param init run once on every thread, including the caller, if set
+  threadPool(int threads, std::function<void()> init = std::function<void()>())
+    : size(std::max(threads,1)), ranges(new slot[std::max(threads,1)]), eachBounds(std::max(threads,1) + 1)
+  {
+    for(int t=0;t<=size;t++)
+      eachBounds[t] = t;
+    for(int t=1;t<size;t++)
+      workers.push_back(std::thread(&threadPool::work,this,t,init));
+    if(init)
+      init();
+    while(started.load(std::memory_order_acquire) < size - 1)
+      std::this_thread::yield();
+  }
+
+  ~threadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      generation++;
+    }
+    wake.notify_all();
+    for(std::thread &w : workers)
+      w.join();
+  }
+
+  threadPool(const threadPool&) = delete;
+  threadPool& operator=(const threadPool&) = delete;
+
+  /// \return the number of threads, including the caller
+  int threads() const{
+    return size;}
+
+  /// Splits a list of tasks into one contiguous range per thread of
+  /// roughly equal total cost
+  /// \param costs the estimated cost of each task
+  /// \return threads()+1 bounds, thread t starting with task bounds[t]
+  std::vector<int> partition(const std::vector<double> &costs) const
+  {
+    double total = 0;
+    for(double c : costs)
+      total+=c;
+    std::vector<int> bounds(size + 1,(int)costs.size());
+    bounds[0] = 0;
+    double sum = 0;
+    int t = 1;
+    for(int i=0;i<(int)costs.size() && t<size;i++)
+      {
+	sum+=costs[i];
+	while(t < size && sum >= total*t/size)
+	  bounds[t++] = i + 1;
+      }
+    return bounds;
+  }
+
+  /// Runs body(i) for every task i, returning once all are done
+  /// \param bounds the range of each thread, from partition()
+  /// \param body callable taking the task index
+  template <typename F>
+  void run(const std::vector<int> &bounds, F &body)
+  {
+    if(size == 1)
+      {
+	for(int i=bounds.front();i<bounds.back();i++)
+	  body(i);
+	return;
+      }
+    for(int t=0;t<size;t++)
+      ranges[t].range.store(pack(bounds[t],bounds[t + 1]),std::memory_order_relaxed);
+    task = &invoke<F>;
+    context = &body;
+    pending.store(size - 1,std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      generation++;
+    }
+    wake.notify_all();
+    drain(0);
+    while(pending.load(std::memory_order_acquire))
+      std::this_thread::yield();
+  }
+
+  /// Runs body(t) once on every thread t, without stealing, returning once
+  /// all are done. Used to run a scheduler loop on each thread.
+  /// \param body callable taking the thread index
+  template <typename F>
+  void runOnEach(F &body)
+  {
+    stealing = false;
+    run(eachBounds,body);
+    stealing = true;
+  }
+
+private:
+  /// a thread's remaining range, alone on its cache line
+  struct alignas(64) slot
+  {
+    std::atomic<uint64_t> range{0}; ///< first task in the high, end in the low 32 bits
+  };
+
+  int size; ///< number of threads including the caller
+  std::unique_ptr<slot[]> ranges; ///< the remaining range of each thread
+  std::vector<int> eachBounds; ///< one task per thread, for runOnEach
+  std::vector<std::thread> workers; ///< threads 1 to size-1
+  std::mutex mutex; ///< guards sleeping and waking
+  std::condition_variable wake; ///< signalled on a new loop
+  std::atomic<unsigned long> generation{0}; ///< number of loops started
+  std::atomic<int> pending{0}; ///< workers yet to finish the current loop
+  std::atomic<int> started{0}; ///< workers that have run init
+  bool stopping = false; ///< set to shut the workers down
+  bool stealing = true; ///< whether threads take tasks from the others' ranges
+  void (*task)(void*,int) = nullptr; ///< runs one task of the current loop
+  void* context = nullptr; ///< the body of the current loop
+
+  template <typename F>
+  static void invoke(void* body, int i){
+    (*static_cast<F*>(body))(i);}
+
+  static uint64_t pack(int first, int end){
+    return ((uint64_t)(uint32_t)first << 32) | (uint32_t)end;}
+
+  /// claims the first task of a range, or returns -1 if it is empty
+  int claimFront(int t)
+  {
+    uint64_t r = ranges[t].range.load(std::memory_order_relaxed);
+    for(;;)
+      {
+	const int first = r >> 32, end = (uint32_t)r;
+	if(first >= end)
+	  return -1;
+	if(ranges[t].range.compare_exchange_weak(r,pack(first + 1,end),std::memory_order_relaxed))
+	  return first;
+      }
+  }
+
+  /// claims the last task of a range, or returns -1 if it is empty
+  int claimBack(int t)
+  {
+    uint64_t r = ranges[t].range.load(std::memory_order_relaxed);
+    for(;;)
+      {
+	const int first = r >> 32, end = (uint32_t)r;
+	if(first >= end)
+	  return -1;
+	if(ranges[t].range.compare_exchange_weak(r,pack(first,end - 1),std::memory_order_relaxed))
+	  return end - 1;
+      }
+  }
+
+  /// works through a thread's own range, then steals from the others
+  void drain(int self)
+  {
+    int i;
+    while((i = claimFront(self)) >= 0)
+      task(context,i);
+    for(int k=1;stealing && k<size;k++)
+      while((i = claimBack((self + k)%size)) >= 0)
+	task(context,i);
+  }
+
+  /// the loop of worker thread self
+  void work(int self, std::function<void()> init)
+  {
+    if(init)
+      init();
+    started.fetch_add(1,std::memory_order_release);
+    unsigned long seen = 0;
+    for(;;)
+      {
+	for(int spin=0;spin<THREADPOOL_SPIN && generation.load(std::memory_order_acquire) == seen;spin++)
+	  std::atomic_signal_fence(std::memory_order_seq_cst);
+	{
+	  std::unique_lock<std::mutex> lock(mutex);
+	  wake.wait(lock,[&](){ return generation.load() != seen;});
+	  seen = generation.load();
+	  if(stopping)
+	    return;
+	}
+	drain(self);
+	pending.fetch_sub(1,std::memory_order_release);
+      }
+  }
+};
+
+#endif
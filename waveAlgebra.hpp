@@ -0,0 +1,110 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <boost/numeric/odeint.hpp>
+#include "multiDomainWave.hpp"
+
+#ifndef WAVEALGEBRA_H
+#define WAVEALGEBRA_H
+
+// smallest state, in doubles, whose stage updates are split over the
+// wave's threads; below it dispatching costs more than the loop
+#ifndef PARALLEL_ALGEBRA_SIZE
+#define PARALLEL_ALGEBRA_SIZE 32768
+#endif
+
+/// odeint algebra for the flattened state of a multiDomainWave
+
+/// odeint's range_algebra walks the state through generic iterators, one
+/// thread, element by element. This algebra runs each stage combination as a
+/// plain loop over the raw arrays, which the compiler vectorizes, and on a
+/// wave with a thread pool splits it into the same per-thread ranges of
+/// domains as the right-hand side, without stealing, so each thread updates
+/// the part of the state it has just differentiated and still holds in
+/// cache. Pair it with odeint's default_operations, e.g.
+/// runge_kutta4<std::vector<double>,double,std::vector<double>,double,waveAlgebra,default_operations>.
+struct waveAlgebra
+{
+  const multiDomainWave* wave = nullptr; ///< the wave whose pool and partition are used, null to run serially
+
+  waveAlgebra() {}
+
+  /// \param in_wave the wave whose state is evolved
+  waveAlgebra(const multiDomainWave* in_wave) : wave(in_wave) {}
+
+  template <class S1, class Op>
+  void for_each1(S1 &s1, Op op) const{
+    forEach(op,s1);}
+
+  template <class S1, class S2, class Op>
+  void for_each2(S1 &s1, S2 &s2, Op op) const{
+    forEach(op,s1,s2);}
+
+  template <class S1, class S2, class S3, class Op>
+  void for_each3(S1 &s1, S2 &s2, S3 &s3, Op op) const{
+    forEach(op,s1,s2,s3);}
+
+  template <class S1, class S2, class S3, class S4, class Op>
+  void for_each4(S1 &s1, S2 &s2, S3 &s3, S4 &s4, Op op) const{
+    forEach(op,s1,s2,s3,s4);}
+
+  template <class S1, class S2, class S3, class S4, class S5, class Op>
+  void for_each5(S1 &s1, S2 &s2, S3 &s3, S4 &s4, S5 &s5, Op op) const{
+    forEach(op,s1,s2,s3,s4,s5);}
+
+  template <class S1, class S2, class S3, class S4, class S5, class S6, class Op>
+  void for_each6(S1 &s1, S2 &s2, S3 &s3, S4 &s4, S5 &s5, S6 &s6, Op op) const{
+    forEach(op,s1,s2,s3,s4,s5,s6);}
+
+  template <class S1, class S2, class S3, class S4, class S5, class S6, class S7, class Op>
+  void for_each7(S1 &s1, S2 &s2, S3 &s3, S4 &s4, S5 &s5, S6 &s6, S7 &s7, Op op) const{
+    forEach(op,s1,s2,s3,s4,s5,s6,s7);}
+
+  template <class S1, class S2, class S3, class S4, class S5, class S6, class S7, class S8, class Op>
+  void for_each8(S1 &s1, S2 &s2, S3 &s3, S4 &s4, S5 &s5, S6 &s6, S7 &s7, S8 &s8, Op op) const{
+    forEach(op,s1,s2,s3,s4,s5,s6,s7,s8);}
+
+  /// \return the largest magnitude in a state, for the error control of adaptive steppers
+  template <class S>
+  static double norm_inf(const S &s)
+  {
+    double norm = 0;
+    for(size_t i=0;i<s.size();i++)
+      norm = std::max(norm,fabs(s[i]));
+    return norm;
+  }
+
+private:
+  /// applies op elementwise over the states, in parallel when worthwhile
+  template <class Op, class S1, class... S>
+  void forEach(Op &op, S1 &s1, S&... s) const
+  {
+    const size_t size = s1.size();
+    if(!wave || !wave->pool || size < PARALLEL_ALGEBRA_SIZE)
+      {
+	loop(op,0,size,s1.data(),s.data()...);
+	return;
+      }
+    // thread t takes the elements of the blocks it evaluates in the right-hand side
+    const std::vector<multiDomainWave::domainBlock> &blocks = wave->blocks;
+    const std::vector<int> &bounds = wave->blockBounds;
+    auto range = [&](int t){
+      const size_t lo = (bounds[t] < (int)blocks.size()) ? blocks[bounds[t]].elstart : size;
+      const size_t hi = (bounds[t + 1] < (int)blocks.size()) ? blocks[bounds[t + 1]].elstart : size;
+      loop(op,lo,hi,s1.data(),s.data()...);
+    };
+    wave->pool->runOnEach(range);
+  }
+
+  /// the serial loop over one range, over raw pointers so that it vectorizes
+  template <class Op, class... P>
+  static void loop(const Op &op, size_t lo, size_t hi, P*... p)
+  {
+    // a local copy of the coefficients cannot alias the state, so they stay in registers
+    Op f = op;
+    for(size_t i=lo;i<hi;i++)
+      f(p[i]...);
+  }
+};
+
+#endif